@@ -0,0 +1,328 @@
+# Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+"""Python access to the airflow network solver through the libairflownetwork C interface.
+
+The pressure, flow and concentration arrays are NumPy views of the model's own memory, so reading
+them after a solve costs nothing. They follow the model and should not be kept past its lifetime.
+The library is found with the AIRFLOWNETWORK_LIBRARY environment variable, next to this file, or
+on the usual library search path.
+"""
+import ctypes
+import ctypes.util
+import os
+import sys
+import numpy as np
+
+OK = 0
+NOT_CONVERGED = 1
+BAD_ARGUMENT = 2
+ERROR = 3
+
+SIMULATED = 0
+FIXED = 1
+CALCULATED = 2
+
+class Error(Exception):
+    pass
+
+class NotConverged(Error):
+    pass
+
+_size_t_p = ctypes.POINTER(ctypes.c_size_t)
+_double_p = ctypes.POINTER(ctypes.c_double)
+_int_p = ctypes.POINTER(ctypes.c_int)
+_char_pp = ctypes.POINTER(ctypes.c_char_p)
+
+_prototypes = {
+    'afn_last_error': (ctypes.c_char_p, []),
+    'afn_create_from_xml_file': (ctypes.c_void_p, [ctypes.c_char_p]),
+    'afn_create_from_xml_string': (ctypes.c_void_p, [ctypes.c_char_p]),
+    'afn_create': (ctypes.c_void_p, [ctypes.c_size_t, _char_pp, _int_p, _double_p, _double_p, _double_p,
+                                     ctypes.c_size_t, _char_pp, _double_p, _double_p,
+                                     ctypes.c_size_t, _char_pp, _size_t_p, _size_t_p, _size_t_p]),
+    'afn_destroy': (None, [ctypes.c_void_p]),
+    'afn_node_count': (ctypes.c_size_t, [ctypes.c_void_p]),
+    'afn_link_count': (ctypes.c_size_t, [ctypes.c_void_p]),
+    'afn_find_node': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_char_p, _size_t_p]),
+    'afn_find_link': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_char_p, _size_t_p]),
+    'afn_link_nodes': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, _size_t_p, _size_t_p]),
+    'afn_set_node_state': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_double, ctypes.c_double,
+                                          ctypes.c_double]),
+    'afn_set_node_pressures': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, _size_t_p, _double_p]),
+    'afn_set_link_control': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_double]),
+    'afn_set_link_controls': (ctypes.c_int, [ctypes.c_void_p, _double_p]),
+    'afn_set_tolerance': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_double, ctypes.c_int]),
+    'afn_solve': (ctypes.c_int, [ctypes.c_void_p]),
+    'afn_get_pressures': (ctypes.c_int, [ctypes.c_void_p, _double_p, ctypes.c_size_t]),
+    'afn_get_flows': (ctypes.c_int, [ctypes.c_void_p, _double_p, ctypes.c_size_t]),
+    'afn_pressure_data': (_double_p, [ctypes.c_void_p]),
+    'afn_flow_data': (_double_p, [ctypes.c_void_p]),
+    'afn_node_indices': (ctypes.c_int, [ctypes.c_void_p, _size_t_p, ctypes.c_size_t]),
+    'afn_set_species_count': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t]),
+    'afn_concentration_data': (_double_p, [ctypes.c_void_p, ctypes.c_size_t, _size_t_p]),
+    'afn_solve_batch': (ctypes.c_int, [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t, _size_t_p, _double_p,
+                                       _double_p, _double_p, _double_p, _int_p]),
+}
+
+def _find_library():
+    path = os.environ.get('AIRFLOWNETWORK_LIBRARY')
+    if path:
+        return path
+    suffix = {'win32': '.dll', 'darwin': '.dylib'}.get(sys.platform, '.so')
+    here = os.path.dirname(os.path.abspath(__file__))
+    for directory in (here, os.path.join(here, '..', 'build', 'bin')):
+        candidate = os.path.join(directory, 'libairflownetwork' + suffix)
+        if os.path.exists(candidate):
+            return candidate
+    path = ctypes.util.find_library('airflownetwork')
+    if path is None:
+        raise Error('Unable to find libairflownetwork, set AIRFLOWNETWORK_LIBRARY to its location')
+    return path
+
+_lib = None
+
+def library():
+    global _lib
+    if _lib is None:
+        lib = ctypes.CDLL(_find_library())
+        for name, (restype, argtypes) in _prototypes.items():
+            function = getattr(lib, name)
+            function.restype = restype
+            function.argtypes = argtypes
+        _lib = lib
+    return _lib
+
+def _last_error():
+    return library().afn_last_error().decode()
+
+def _check(code):
+    if code == NOT_CONVERGED:
+        raise NotConverged(_last_error())
+    if code != OK:
+        raise Error(_last_error())
+
+def _pointer(array, ctype):
+    if array is None:
+        return None
+    return array.ctypes.data_as(ctypes.POINTER(ctype))
+
+def _doubles(values):
+    return np.ascontiguousarray(values, dtype=np.float64)
+
+def _sizes(values):
+    return np.ascontiguousarray(values, dtype=np.uintp)
+
+def _names(names):
+    if names is None:
+        return None
+    return (ctypes.c_char_p * len(names))(*[name.encode() for name in names])
+
+def _view(pointer, size):
+    if size == 0 or not pointer:
+        return np.empty(0)
+    array = np.ctypeslib.as_array(pointer, shape=(size,))
+    array.flags.writeable = False
+    return array
+
+class Model:
+    def __init__(self, handle):
+        self._handle = None
+        if not handle:
+            raise Error(_last_error())
+        self._lib = library()
+        self._handle = ctypes.c_void_p(handle)
+
+    @classmethod
+    def from_xml_file(cls, filename):
+        return cls(library().afn_create_from_xml_file(os.fsencode(filename)))
+
+    @classmethod
+    def from_xml_string(cls, xml):
+        return cls(library().afn_create_from_xml_string(xml.encode()))
+
+    @classmethod
+    def from_arrays(cls, node_types, coefficients, exponents, node0, node1, elements, node_names=None, heights=None,
+                    pressures=None, temperatures=None, element_names=None, link_names=None):
+        """Build a model of power law links, see afn_create for the meaning of the arrays.
+
+        The optional arrays (None to use the defaults) must be the same length as the required array for
+        the same kind of object, e.g. exponents and coefficients.
+        """
+        node_types = np.ascontiguousarray(node_types, dtype=np.intc)
+        coefficients = _doubles(coefficients)
+        exponents = None if exponents is None else _doubles(exponents)
+        node0 = _sizes(node0)
+        node1 = _sizes(node1)
+        elements = _sizes(elements)
+        heights = None if heights is None else _doubles(heights)
+        pressures = None if pressures is None else _doubles(pressures)
+        temperatures = None if temperatures is None else _doubles(temperatures)
+        for what, arrays, count in (('node', (node_names, heights, pressures, temperatures), len(node_types)),
+                                    ('element', (element_names, exponents), len(coefficients)),
+                                    ('link', (node1, elements, link_names), len(node0))):
+            for array in arrays:
+                if array is not None and len(array) != count:
+                    raise Error('Expected %d %s values, got %d' % (count, what, len(array)))
+        return cls(library().afn_create(len(node_types), _names(node_names), _pointer(node_types, ctypes.c_int),
+                                        _pointer(heights, ctypes.c_double), _pointer(pressures, ctypes.c_double),
+                                        _pointer(temperatures, ctypes.c_double), len(coefficients),
+                                        _names(element_names), _pointer(coefficients, ctypes.c_double),
+                                        _pointer(exponents, ctypes.c_double), len(node0), _names(link_names),
+                                        _pointer(node0, ctypes.c_size_t), _pointer(node1, ctypes.c_size_t),
+                                        _pointer(elements, ctypes.c_size_t)))
+
+    def close(self):
+        if self._handle:
+            self._lib.afn_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    @property
+    def node_count(self):
+        return self._lib.afn_node_count(self._handle)
+
+    @property
+    def link_count(self):
+        return self._lib.afn_link_count(self._handle)
+
+    def find_node(self, name):
+        handle = ctypes.c_size_t()
+        _check(self._lib.afn_find_node(self._handle, name.encode(), ctypes.byref(handle)))
+        return handle.value
+
+    def find_link(self, name):
+        handle = ctypes.c_size_t()
+        _check(self._lib.afn_find_link(self._handle, name.encode(), ctypes.byref(handle)))
+        return handle.value
+
+    def link_nodes(self, link):
+        node0 = ctypes.c_size_t()
+        node1 = ctypes.c_size_t()
+        _check(self._lib.afn_link_nodes(self._handle, link, ctypes.byref(node0), ctypes.byref(node1)))
+        return node0.value, node1.value
+
+    @property
+    def node_index(self):
+        """Position of each node (by handle) in the pressures array"""
+        indices = np.empty(self.node_count, dtype=np.uintp)
+        _check(self._lib.afn_node_indices(self._handle, _pointer(indices, ctypes.c_size_t), len(indices)))
+        return indices
+
+    @property
+    def pressures(self):
+        """Read-only view of the solver pressures, in solver order (see node_index)"""
+        return _view(self._lib.afn_pressure_data(self._handle), self.node_count)
+
+    @property
+    def node_pressures(self):
+        """Copy of the pressures in node handle order"""
+        return self.pressures[self.node_index]
+
+    @property
+    def flows(self):
+        """Read-only view of the link flows, in link order"""
+        return _view(self._lib.afn_flow_data(self._handle), self.link_count)
+
+    def set_species_count(self, count):
+        _check(self._lib.afn_set_species_count(self._handle, count))
+
+    def concentrations(self, node):
+        """Writable view of the concentrations of one node, these are not stored contiguously across nodes"""
+        count = ctypes.c_size_t()
+        pointer = self._lib.afn_concentration_data(self._handle, node, ctypes.byref(count))
+        if not pointer:
+            if node >= self.node_count:
+                raise Error(_last_error())
+            return np.empty(0)
+        return np.ctypeslib.as_array(pointer, shape=(count.value,))
+
+    def set_node_state(self, node, pressure, temperature, humidity_ratio=0.0):
+        _check(self._lib.afn_set_node_state(self._handle, node, pressure, temperature, humidity_ratio))
+
+    def set_node_pressures(self, nodes, pressures):
+        nodes = _sizes(nodes)
+        pressures = _doubles(pressures)
+        if len(nodes) != len(pressures):
+            raise Error('Node and pressure counts differ')
+        _check(self._lib.afn_set_node_pressures(self._handle, len(nodes), _pointer(nodes, ctypes.c_size_t),
+                                                _pointer(pressures, ctypes.c_double)))
+
+    def set_link_control(self, link, control):
+        _check(self._lib.afn_set_link_control(self._handle, link, control))
+
+    def set_link_controls(self, controls):
+        controls = _doubles(controls)
+        if len(controls) != self.link_count:
+            raise Error('Expected %d link controls' % self.link_count)
+        _check(self._lib.afn_set_link_controls(self._handle, _pointer(controls, ctypes.c_double)))
+
+    def set_tolerance(self, tolerance, max_iterations=25):
+        """Set the convergence tolerance and the Newton iteration limit, views taken earlier stay valid"""
+        _check(self._lib.afn_set_tolerance(self._handle, tolerance, max_iterations))
+
+    def solve(self):
+        """Solve for the steady state, raises NotConverged if the iteration limit is hit"""
+        _check(self._lib.afn_solve(self._handle))
+
+    def solve_batch(self, nodes, pressures, controls=None, check=True):
+        """Solve one case per row of pressures (cases x len(nodes)) and, optionally, controls (cases x links).
+
+        Returns the pressures in node handle order (cases x nodes), the flows (cases x links) and the
+        status of each case. If check is true, a case that fails to converge raises NotConverged.
+        """
+        nodes = _sizes(nodes)
+        if len(nodes) == 0:
+            # Only the controls change, so they say how many cases there are
+            if controls is None:
+                raise Error('Expected node pressures or link controls to change between cases')
+            controls = _doubles(controls).reshape(-1, self.link_count)
+            cases = controls.shape[0]
+            pressures = np.empty((cases, 0))
+        else:
+            pressures = _doubles(pressures).reshape(-1, len(nodes))
+            cases = pressures.shape[0]
+            if controls is not None:
+                controls = _doubles(controls).reshape(cases, self.link_count)
+        out_pressures = np.empty((cases, self.node_count))
+        out_flows = np.empty((cases, self.link_count))
+        status = np.empty(cases, dtype=np.intc)
+        code = self._lib.afn_solve_batch(self._handle, cases, len(nodes), _pointer(nodes, ctypes.c_size_t),
+                                         _pointer(pressures, ctypes.c_double), _pointer(controls, ctypes.c_double),
+                                         _pointer(out_pressures, ctypes.c_double), _pointer(out_flows, ctypes.c_double),
+                                         _pointer(status, ctypes.c_int))
+        if code != NOT_CONVERGED or check:
+            _check(code)
+        return out_pressures, out_flows, status
@@ -26,19 +26,43 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
+#include <fstream>
+#include <string>
 #include "pugixml.hpp"
 #include "model.hpp"
 
 int main(int argc, char* argv[])
 {
-  if (argc < 2) {
-    std::cerr << "usage: airflownetwork <xml>" << std::endl;
+  std::string filename;
+  std::string statistics;
+  std::string trace;
+  std::string convergence;
+  std::string output{ "output" };
+  bool memory{ false };
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{ argv[i] };
+    if (arg == "--memory") {
+      memory = true;
+    } else if (arg == "--statistics" && i + 1 < argc) {
+      statistics = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      trace = argv[++i];
+    } else if (arg == "--convergence" && i + 1 < argc) {
+      convergence = argv[++i];
+    } else if (arg == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      filename = arg;
+    }
+  }
+  if (filename.empty()) {
+    std::cerr << "usage: airflownetwork [--statistics FILE] [--trace FILE] [--convergence FILE] [--output BASE] [--memory] <xml>" << std::endl;
     return 1;
   }
   pugi::xml_document doc;
-  pugi::xml_parse_result result = doc.load_file(argv[1]);
+  pugi::xml_parse_result result = doc.load_file(filename.c_str());
   if (!result) {
-    std::cerr << "Failed to load XML file name \"" << argv[1] << '\"' << std::endl;
+    std::cerr << "Failed to load XML file name \"" << filename << '\"' << std::endl;
   }
 
   std::string root_name{ "AirflowNetwork" };
@@ -48,7 +72,7 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  airflownetwork::Model<size_t, airflownetwork::properties::AIRNET> model("main");
+  airflownetwork::Model<airflownetwork::Index, airflownetwork::properties::AIRNET> model("main");
   if (!model.load(afn)) {
     std::cerr << "Failed to load AirflowNetwork model" << std::endl;
     for (auto& mesg : model.errors) {
@@ -57,11 +81,16 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (memory) {
+    std::cout << "Memory ---------------" << std::endl;
+    model.memory_usage().write(std::cout);
+  }
+
   int element_count = 0;
   std::cout << "Elements ------------- " << std::endl;
   for (auto& el : model.powerlaw_elements) {
     ++element_count;
-    std::cout << "\tPower Law:" << el.name << std::endl;
+    std::cout << "\tPower Law:" << model.names[el.name] << std::endl;
   }
   std::cout << "Found " << element_count << " Element(s)" << std::endl;
 
@@ -69,22 +98,22 @@ int main(int argc, char* argv[])
   std::cout << "Materials ------------ " << std::endl;
   for (auto& el : model.materials) {
     ++material_count;
-    std::cout << "\tMaterial:" << el.name << std::endl;
+    std::cout << "\tMaterial:" << model.names[el.name] << std::endl;
   }
   std::cout << "Found " << material_count << " Material(s)" << std::endl;
 
   int node_count = 0;
   std::cout << "Nodes ---------------- " << std::endl;
   for (auto& el : model.simulated_nodes) {
-    std::cout << "\tSimulated:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tSimulated:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   for (auto& el : model.fixed_nodes) {
-    std::cout << "\tFixed:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tFixed:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   for (auto& el : model.calculated_nodes) {
-    std::cout << "\tCalculated:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tCalculated:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   /*
@@ -113,8 +142,8 @@ int main(int argc, char* argv[])
   std::cout << "Links ---------------- " << std::endl;
   for (auto& el : model.links) {
     ++link_count;
-    std::cout << '\t' << el.name << '(' << el.node0.name << "--" << el.element.name << "-->" << el.node1.name << "), ["
-      << el.index0 << ',' << el.index1 << ']' << std::endl;
+    std::cout << '\t' << model.names[el.name] << '(' << model.names[el.node0.name] << "--" << model.names[el.element.name] << "-->"
+      << model.names[el.node1.name] << "), [" << el.index0 << ',' << el.index1 << ']' << std::endl;
   }
 
   std::cout << "Found " << link_count << " Link(s)" << std::endl;
@@ -130,13 +159,42 @@ int main(int argc, char* argv[])
 
   //model.save("out.xml");
 
-  model.open_output("output");
+  // An <Outputs> section in the XML selects what is written, otherwise every pressure and flow goes to BASE_p.csv and BASE_f.csv
+  if (!model.open_output(output)) {
+    for (auto& mesg : model.errors) {
+      std::cerr << mesg << std::endl;
+    }
+    return 1;
+  }
   model.write_output(0.0);
 
-  model.steady_solve();
-  model.write_output(0.0);
+  airflownetwork::trace::Recorder recorder;
+  if (!trace.empty()) {
+    model.tracer = &recorder;
+  }
+  {
+    airflownetwork::trace::Span span(model.tracer, "timestep", "simulation");
+    span.arg("time", 0.0);
+    model.steady_solve();
+    model.write_output(0.0);
+  }
 
   model.close_output();
 
+  if (!statistics.empty()) {
+    std::ofstream file(statistics);
+    model.statistics.write_json(file);
+  }
+
+  if (!convergence.empty()) {
+    std::ofstream file(convergence);
+    model.write_convergence_report(file);
+  }
+
+  if (!trace.empty()) {
+    std::ofstream file(trace);
+    recorder.write_json(file);
+  }
+
   return 0;
 }
\ No newline at end of file
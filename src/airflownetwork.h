@@ -0,0 +1,139 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_H
+#define AIRFLOWNETWORK_H
+
+/* C interface to the airflow network solver, built as the libairflownetwork shared library.
+ *
+ * Nodes, elements and links are identified by their handles, which are assigned in the order the
+ * objects are defined (in the XML or in the arrays). Functions that can fail return one of the
+ * status codes below and leave a description of the problem in afn_last_error().
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(AIRFLOWNETWORK_C_API_EXPORTS)
+#    define AFN_API __declspec(dllexport)
+#  else
+#    define AFN_API __declspec(dllimport)
+#  endif
+#else
+#  define AFN_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum
+{
+  AFN_OK = 0,
+  AFN_NOT_CONVERGED = 1,
+  AFN_BAD_ARGUMENT = 2,
+  AFN_ERROR = 3
+};
+
+enum
+{
+  AFN_SIMULATED = 0,
+  AFN_FIXED = 1,
+  AFN_CALCULATED = 2
+};
+
+typedef struct afn_model afn_model;
+
+/* Description of the last failure on the calling thread */
+AFN_API const char* afn_last_error(void);
+
+/* Model creation, these return NULL on failure */
+AFN_API afn_model* afn_create_from_xml_file(const char* filename);
+AFN_API afn_model* afn_create_from_xml_string(const char* xml);
+
+/* Create a model from arrays. Names may be NULL, in which case the objects are named by type and
+ * handle (e.g. "Node3"). Node types are AFN_SIMULATED, AFN_FIXED or AFN_CALCULATED, temperatures are
+ * in C and pressures are absolute in Pa. The elements are power laws with the laminar coefficient
+ * equal to the turbulent coefficient. */
+AFN_API afn_model* afn_create(size_t node_count, const char* const* node_names, const int* node_types, const double* heights,
+  const double* pressures, const double* temperatures, size_t element_count, const char* const* element_names,
+  const double* coefficients, const double* exponents, size_t link_count, const char* const* link_names, const size_t* node0,
+  const size_t* node1, const size_t* elements);
+
+AFN_API void afn_destroy(afn_model* model);
+
+AFN_API size_t afn_node_count(const afn_model* model);
+AFN_API size_t afn_link_count(const afn_model* model);
+
+/* Look up a handle by name, returns AFN_BAD_ARGUMENT if there is no such object */
+AFN_API int afn_find_node(const afn_model* model, const char* name, size_t* node);
+AFN_API int afn_find_link(const afn_model* model, const char* name, size_t* link);
+
+/* Links are stored with their nodes in solver order, so a link may be reversed relative to how it
+ * was defined. Flows are positive from the returned node0 to node1. */
+AFN_API int afn_link_nodes(const afn_model* model, size_t link, size_t* node0, size_t* node1);
+
+/* Boundary conditions and controls, these take effect at the next solve */
+AFN_API int afn_set_node_state(afn_model* model, size_t node, double pressure, double temperature, double humidity_ratio);
+AFN_API int afn_set_node_pressures(afn_model* model, size_t count, const size_t* nodes, const double* pressures);
+AFN_API int afn_set_link_control(afn_model* model, size_t link, double control);
+AFN_API int afn_set_link_controls(afn_model* model, const double* controls);
+
+/* Convergence tolerance on the largest mass flow residual [kg/s] and the Newton iteration limit */
+AFN_API int afn_set_tolerance(afn_model* model, double tolerance, int max_iterations);
+
+/* Solve for the steady state pressures and flows, returns AFN_NOT_CONVERGED if the iteration limit is hit */
+AFN_API int afn_solve(afn_model* model);
+
+/* Copy results into caller buffers, sized for at least afn_node_count() or afn_link_count() values */
+AFN_API int afn_get_pressures(const afn_model* model, double* pressures, size_t size);
+AFN_API int afn_get_flows(const afn_model* model, double* flows, size_t size);
+
+/* Direct access to the solver state, valid for the life of the model. The pressures are in solver
+ * order (afn_node_indices() gives the position of each node) and the flows are in link order. Treat
+ * these as read-only, the solver overwrites them. */
+AFN_API const double* afn_pressure_data(const afn_model* model);
+AFN_API const double* afn_flow_data(const afn_model* model);
+AFN_API int afn_node_indices(const afn_model* model, size_t* indices, size_t size);
+
+/* Concentrations are stored per node, set the number of species before asking for them */
+AFN_API int afn_set_species_count(afn_model* model, size_t count);
+AFN_API double* afn_concentration_data(afn_model* model, size_t node, size_t* count);
+
+/* Solve a batch of cases that differ in some node pressures and (optionally) the link controls.
+ * Case i sets nodes[j] to pressures[i*count + j] and, if controls is not NULL, the link controls to
+ * controls[i*afn_link_count() ...]. Each solve starts from the previous solution. The outputs may
+ * be NULL, otherwise they receive afn_node_count() pressures, afn_link_count() flows, and a status
+ * per case. Returns AFN_NOT_CONVERGED if any case failed to converge. */
+AFN_API int afn_solve_batch(afn_model* model, size_t cases, size_t count, const size_t* nodes, const double* pressures,
+  const double* controls, double* out_pressures, double* out_flows, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AIRFLOWNETWORK_H */
@@ -0,0 +1,214 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_ARENA_HPP
+#define AIRFLOWNETWORK_ARENA_HPP
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace airflownetwork {
+
+// Chunked storage with stable addresses. Objects are stored contiguously within fixed-size chunks
+// and are never moved once constructed, so references and pointers to them (e.g. the nodes in a
+// link) stay valid as the arena grows. Objects are addressed by index in insertion order.
+template <typename T, size_t Shift = 10> class Arena
+{
+  static constexpr size_t chunk_size{ size_t(1) << Shift };
+  static constexpr size_t mask{ chunk_size - 1 };
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+public:
+  template <typename A, typename V> class Iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef V value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef V* pointer;
+    typedef V& reference;
+
+    Iterator(A* arena, size_t index) : m_arena(arena), m_index(index)
+    {}
+
+    V& operator*() const
+    {
+      return (*m_arena)[m_index];
+    }
+
+    V* operator->() const
+    {
+      return &(*m_arena)[m_index];
+    }
+
+    Iterator& operator++()
+    {
+      ++m_index;
+      return *this;
+    }
+
+    Iterator operator++(int)
+    {
+      Iterator it{ *this };
+      ++m_index;
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const
+    {
+      return m_index == other.m_index;
+    }
+
+    bool operator!=(const Iterator& other) const
+    {
+      return m_index != other.m_index;
+    }
+
+  private:
+    A* m_arena;
+    size_t m_index;
+  };
+
+  typedef T value_type;
+  typedef Iterator<Arena, T> iterator;
+  typedef Iterator<const Arena, const T> const_iterator;
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  Arena(Arena&& other) : m_chunks(std::move(other.m_chunks)), m_size(other.m_size)
+  {
+    other.m_chunks.clear();
+    other.m_size = 0;
+  }
+
+  Arena& operator=(Arena&& other)
+  {
+    if (this != &other) {
+      clear();
+      m_chunks = std::move(other.m_chunks);
+      m_size = other.m_size;
+      other.m_chunks.clear();
+      other.m_size = 0;
+    }
+    return *this;
+  }
+
+  ~Arena()
+  {
+    clear();
+  }
+
+  template <typename... Args> T& emplace_back(Args&&... args)
+  {
+    if ((m_size >> Shift) == m_chunks.size()) {
+      m_chunks.emplace_back(new Slot[chunk_size]);
+    }
+    T* object = new (&m_chunks[m_size >> Shift][m_size & mask]) T(std::forward<Args>(args)...);
+    ++m_size;
+    return *object;
+  }
+
+  T& operator[](size_t index)
+  {
+    return *reinterpret_cast<T*>(&m_chunks[index >> Shift][index & mask]);
+  }
+
+  const T& operator[](size_t index) const
+  {
+    return *reinterpret_cast<const T*>(&m_chunks[index >> Shift][index & mask]);
+  }
+
+  T& back()
+  {
+    return (*this)[m_size - 1];
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < m_size; ++i) {
+      (*this)[i].~T();
+    }
+    m_size = 0;
+    m_chunks.clear();
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+
+  bool empty() const
+  {
+    return m_size == 0;
+  }
+
+  // Number of objects that fit in the allocated chunks
+  size_t capacity() const
+  {
+    return m_chunks.size() * chunk_size;
+  }
+
+  // Bytes allocated for the chunks and the chunk table, not counting anything the objects allocate
+  size_t memory_usage() const
+  {
+    return capacity() * sizeof(Slot) + m_chunks.capacity() * sizeof(std::unique_ptr<Slot[]>);
+  }
+
+  iterator begin()
+  {
+    return iterator(this, 0);
+  }
+
+  iterator end()
+  {
+    return iterator(this, m_size);
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(this, m_size);
+  }
+
+private:
+  std::vector<std::unique_ptr<Slot[]>> m_chunks;
+  size_t m_size{ 0 };
+};
+
+}
+
+#endif // !AIRFLOWNETWORK_ARENA_HPP
@@ -0,0 +1,252 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_BENCHMARK_HPP
+#define AIRFLOWNETWORK_BENCHMARK_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <ostream>
+#include <istream>
+#include <sstream>
+#include <map>
+#include "output.hpp"
+
+namespace airflownetwork {
+namespace benchmark {
+
+// Summary statistics of the repetition times, in seconds
+struct Statistics
+{
+  Statistics() = default;
+
+  explicit Statistics(std::vector<double> samples)
+  {
+    if (samples.empty()) {
+      return;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t n{ samples.size() };
+    minimum = samples.front();
+    maximum = samples.back();
+    median = n % 2 == 1 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double sum{ 0.0 };
+    for (auto value : samples) {
+      sum += (value - mean) * (value - mean);
+    }
+    stddev = n > 1 ? std::sqrt(sum / (n - 1)) : 0.0;
+  }
+
+  double minimum{ 0.0 };
+  double maximum{ 0.0 };
+  double mean{ 0.0 };
+  double median{ 0.0 };
+  double stddev{ 0.0 };
+};
+
+struct Result
+{
+  double nanoseconds() const
+  {
+    return 1.0e9 * statistics.median / operations;
+  }
+
+  // The fastest repetition is the least disturbed by other load on the machine
+  double fastest() const
+  {
+    return 1.0e9 * statistics.minimum / operations;
+  }
+
+  std::string name;
+  size_t operations; // Operations per repetition
+  size_t repetitions;
+  Statistics statistics;
+};
+
+// Runs each benchmark body a number of times after some untimed warmup runs
+class Suite
+{
+public:
+  Suite(size_t warmup = 2, size_t repetitions = 10, const std::string& filter = "*") : warmup(warmup), repetitions(repetitions),
+    filter(filter)
+  {}
+
+  // Time the body, the setup is run before each repetition and is not timed
+  template <typename S, typename F> void run(const std::string& name, size_t operations, S&& setup, F&& body)
+  {
+    if (!output::match(filter, name)) {
+      return;
+    }
+    for (size_t i = 0; i < warmup; ++i) {
+      setup();
+      body();
+    }
+    std::vector<double> samples(repetitions);
+    for (auto& sample : samples) {
+      setup();
+      auto start = std::chrono::steady_clock::now();
+      body();
+      auto stop = std::chrono::steady_clock::now();
+      sample = std::chrono::duration<double>(stop - start).count();
+    }
+    results.push_back({ name, operations, repetitions, Statistics(samples) });
+  }
+
+  template <typename F> void run(const std::string& name, size_t operations, F&& body)
+  {
+    run(name, operations, [] {}, body);
+  }
+
+  void write_text(std::ostream& stream) const
+  {
+    for (auto& result : results) {
+      stream << result.name << ": " << result.nanoseconds() << " ns/op (median of "
+        << result.repetitions << ", stddev " << 1.0e9 * result.statistics.stddev / result.operations << " ns/op)\n";
+    }
+  }
+
+  void write_csv(std::ostream& stream) const
+  {
+    stream << "name,operations,repetitions,minimum,maximum,mean,median,stddev\n";
+    for (auto& result : results) {
+      auto& s = result.statistics;
+      stream << result.name << ',' << result.operations << ',' << result.repetitions << ',' << s.minimum << ',' << s.maximum << ','
+        << s.mean << ',' << s.median << ',' << s.stddev << '\n';
+    }
+  }
+
+  void write_json(std::ostream& stream) const
+  {
+    stream << "{\n  \"warmup\": " << warmup << ",\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+      auto& result = results[i];
+      auto& s = result.statistics;
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+        << ", \"repetitions\": " << result.repetitions << ", \"minimum\": " << s.minimum << ", \"maximum\": " << s.maximum
+        << ", \"mean\": " << s.mean << ", \"median\": " << s.median << ", \"stddev\": " << s.stddev << '}';
+    }
+    stream << "\n  ]\n}\n";
+  }
+
+  const size_t warmup;
+  const size_t repetitions;
+  const std::string filter;
+  std::vector<Result> results;
+};
+
+// Reference timings in nanoseconds per operation (of the fastest repetition), each with the fraction it is allowed to slow down by.
+// The file is CSV with lines of name,nanoseconds[,tolerance], and lines starting with '#' are comments.
+struct Baseline
+{
+  struct Entry
+  {
+    double nanoseconds;
+    double tolerance; // Negative to use the default tolerance
+  };
+
+  bool read(std::istream& stream)
+  {
+    std::string line;
+    size_t number{ 0 };
+    while (std::getline(stream, line)) {
+      ++number;
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      std::stringstream fields(line);
+      std::string name, nanoseconds, tolerance;
+      std::getline(fields, name, ',');
+      std::getline(fields, nanoseconds, ',');
+      std::getline(fields, tolerance, ',');
+      try {
+        entries[name] = { std::stod(nanoseconds), tolerance.empty() ? -1.0 : std::stod(tolerance) };
+      } catch (const std::exception&) {
+        errors.push_back("Baseline line " + std::to_string(number) + " is not of the form name,nanoseconds[,tolerance]");
+      }
+    }
+    return errors.empty();
+  }
+
+  void write(std::ostream& stream) const
+  {
+    stream << "# name,nanoseconds per operation,tolerance\n";
+    for (auto& entry : entries) {
+      stream << entry.first << ',' << entry.second.nanoseconds;
+      if (entry.second.tolerance >= 0.0) {
+        stream << ',' << entry.second.tolerance;
+      }
+      stream << '\n';
+    }
+  }
+
+  // Take the timings from a set of results, keeping any tolerances that were already set
+  void update(const std::vector<Result>& results)
+  {
+    for (auto& result : results) {
+      auto found = entries.find(result.name);
+      double tolerance{ found == entries.end() ? -1.0 : found->second.tolerance };
+      entries[result.name] = { result.fastest(), tolerance };
+    }
+  }
+
+  // Report each result against the baseline, returns false if any is slower by more than its tolerance.
+  // Results without a baseline are reported but don't fail.
+  bool compare(const std::vector<Result>& results, double tolerance, std::ostream& report) const
+  {
+    bool success{ true };
+    for (auto& result : results) {
+      report << result.name << ": " << result.fastest() << " ns/op";
+      auto found = entries.find(result.name);
+      if (found == entries.end()) {
+        report << ", no baseline\n";
+        continue;
+      }
+      double allowed{ found->second.tolerance >= 0.0 ? found->second.tolerance : tolerance };
+      double change{ result.fastest() / found->second.nanoseconds - 1.0 };
+      report << ", baseline " << found->second.nanoseconds << " ns/op (" << (change >= 0.0 ? "+" : "") << 100.0 * change << "%)";
+      if (change > allowed) {
+        report << " REGRESSION, more than " << 100.0 * allowed << "% slower";
+        success = false;
+      }
+      report << '\n';
+    }
+    return success;
+  }
+
+  std::map<std::string, Entry> entries;
+  std::vector<std::string> errors;
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_BENCHMARK_HPP
@@ -0,0 +1,283 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <string>
+#include "properties.hpp"
+#include "element.hpp"
+#include "powerlaw.hpp"
+#include "simpleopening.hpp"
+#include "model.hpp"
+#include "eigen_transport.hpp"
+#include "stepper.hpp"
+#include "exponential.hpp"
+#include "profile.hpp"
+#include "benchmark.hpp"
+#include "generator.hpp"
+#include "Eigen/Sparse"
+
+typedef airflownetwork::properties::AIRNET Properties;
+typedef airflownetwork::Model<airflownetwork::Index, Properties> Model;
+typedef Eigen::SparseMatrix<double> Matrix;
+typedef Eigen::VectorXd Vector;
+
+static void reset_pressures(Model& model)
+{
+  for (auto& node : model.simulated_nodes) {
+    node.pressure = Properties::pressure_0;
+  }
+}
+
+static void element_benchmarks(airflownetwork::benchmark::Suite& suite, size_t count)
+{
+  airflownetwork::NameTable names;
+  std::mt19937 rng;
+  std::uniform_real_distribution<double> pressure_drop(-50.0, 50.0);
+  std::uniform_real_distribution<double> pressure(101325.0 - 50.0, 101325.0 + 50.0);
+  std::uniform_real_distribution<double> temperature(10.0, 30.0);
+
+  std::vector<double> pdrop(count);
+  std::vector<airflownetwork::State<Properties>> M(count);
+  std::vector<airflownetwork::State<Properties>> N(count);
+  for (size_t i = 0; i < count; ++i) {
+    pdrop[i] = pressure_drop(rng);
+    M[i].pressure = pressure(rng);
+    M[i].temperature = temperature(rng);
+    M[i].update();
+    N[i].pressure = pressure(rng);
+    N[i].temperature = temperature(rng);
+    N[i].update();
+  }
+
+  std::array<double, 2> F{ {0.0, 0.0} };
+  std::array<double, 2> DF{ {0.0, 0.0} };
+  double sink{ 0.0 };
+
+  suite.run("element/generic_crack0", count, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      airflownetwork::generic_crack0(false, 0.0001, 0.65, pdrop[i], M[i], N[i], F, DF);
+      sink += F[0];
+    }
+  });
+  suite.run("element/generic_crack", count, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      airflownetwork::generic_crack(false, 0.0001, 0.65, pdrop[i], M[i], N[i], F, DF);
+      sink += F[0];
+    }
+  });
+
+  airflownetwork::PowerLaw<Properties> powerlaw(names.intern("PowerLaw"), 0.0001, 0.0001);
+  airflownetwork::ContamXPowerLaw<Properties> contamx(names.intern("ContamX"), 0.0001, 0.0001);
+  airflownetwork::SimpleOpening<Properties> opening(names.intern("SimpleOpening"), 2.0, 1.0, 0.0001, 0.78, 0.0001, 0.0001);
+  std::vector<std::pair<std::string, const airflownetwork::Element<Properties>*>> elements{ { "powerlaw", &powerlaw },
+    { "contamx_powerlaw", &contamx }, { "simple_opening", &opening } };
+  for (auto& element : elements) {
+    auto pointer = element.second;
+    suite.run("element/" + element.first + "/calculate", count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        pointer->calculate(false, pdrop[i], 1.0, 1.0, M[i], N[i], F, DF);
+        sink += F[0];
+      }
+    });
+    suite.run("element/" + element.first + "/linearize", count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        sink += pointer->linearize(1.0, M[i], N[i]);
+      }
+    });
+  }
+  if (sink == 0.123456789) {
+    std::cout << sink << std::endl; // Keep the compiler from discarding the loops
+  }
+}
+
+static void model_benchmarks(airflownetwork::benchmark::Suite& suite, const std::string& xml, Model& model)
+{
+  suite.run("model/xml_load", 1, [&] {
+    pugi::xml_document doc;
+    doc.load_string(xml.c_str());
+    Model loaded("load");
+    loaded.load(doc.child("AirflowNetwork"));
+  });
+  size_t links{ model.links.size() };
+  size_t nodes{ model.simulated_nodes.size() };
+  suite.run("model/setup", 1, [&] { model.setup(); });
+  suite.run("model/gather_links", links, [&] { model.gather_links(); });
+  suite.run("model/scatter_links", links, [&] { model.scatter_links(); });
+  suite.run("model/calculate_stack_pressures", links, [&] { model.calculate_stack_pressures(); });
+  model.calculate_pressure_differences();
+  suite.run("model/filjac", links, [&] { model.filjac(); });
+  suite.run("skyline/ldlt_solve", nodes, [&] { model.filjac(); }, [&] { model.skyline->ldlt_solve(model.sum); });
+  suite.run("model/steady_solve", 1, [&] { reset_pressures(model); }, [&] { model.steady_solve(); });
+}
+
+static void transport_benchmarks(airflownetwork::benchmark::Suite& suite, Model& model)
+{
+  for (auto& link : model.links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  }
+  model.links[0].filters[0].emplace_back(0.5);
+  Eigen::Index n{ static_cast<Eigen::Index>(model.node_count()) };
+  size_t links{ model.links.size() };
+  double h{ 60.0 };
+
+  Matrix base;
+  airflownetwork::transport::Pattern<Matrix> pattern(static_cast<Matrix::StorageIndex>(n), model.links, base);
+  airflownetwork::transport::PassThrough<size_t> pass(model.links, 1);
+  Matrix searched = base;
+  suite.run("transport/matrix/coeff_ref", links, [&] { airflownetwork::transport::matrix(0, searched, model.links); });
+  suite.run("transport/matrix/pattern", links, [&] { airflownetwork::transport::matrix(0, base, model.links, pattern); });
+  suite.run("transport/matrix/pass_through", links, [&] { airflownetwork::transport::matrix(0, base, model.links, pattern, pass); });
+  airflownetwork::ProfileMatrix<size_t> profile(airflownetwork::ProfileMatrix<size_t>::heights(n, model.links));
+  suite.run("transport/matrix/profile", links, [&] { airflownetwork::transport::matrix(0, profile, model.links); });
+
+  Vector G = Vector::Zero(n);
+  G[0] = 1.0e-6;
+  Vector R = Vector::Constant(n, 1.0e-5);
+  Vector A = Vector::Constant(n, 100.0);
+  Vector C = Vector::Zero(n);
+  Vector G1 = G;
+  Matrix system;
+  Eigen::SparseLU<Matrix> solver;
+
+  suite.run("transport/explicit_euler", 1, [&] { airflownetwork::transport::explicit_euler(1.0, base, G, R, A, A, C); });
+  suite.run("transport/implicit_euler", 1, [&] {
+    system = base;
+    G1 = G;
+  }, [&] { airflownetwork::transport::implicit_euler(solver, h, system, G1, R, A, A, C); });
+  Vector G0 = G;
+  suite.run("transport/crank_nicolson", 1, [&] {
+    system = base;
+    G1 = G;
+  }, [&] { airflownetwork::transport::crank_nicolson(solver, h, system, G0, G1, R, R, A, A, C); });
+
+  airflownetwork::transport::Stepper<Matrix, Vector, Eigen::SparseLU<Matrix>> stepper(base);
+  suite.run("transport/stepper/implicit_euler", 1, [&] { G1 = G; }, [&] { stepper.implicit_euler(h, G1, R, A, C); });
+  airflownetwork::transport::SubcycledStepper<Matrix, Vector, Eigen::SparseLU<Matrix>> subcycled(base);
+  suite.run("transport/stepper/subcycled", 1, [&] { subcycled.step(h, G, R, A, C); });
+  airflownetwork::transport::AdaptiveStepper<Matrix, Vector, Eigen::SparseLU<Matrix>> adaptive(base, 1.0, 3600.0);
+  suite.run("transport/stepper/adaptive", 1, [&] { adaptive.advance(3600.0, G, R, A, C); });
+  airflownetwork::transport::ExponentialStepper<Matrix, Vector> exponential(base);
+  suite.run("transport/stepper/exponential", 1, [&] { exponential.step(3600.0, G, R, A, C); });
+
+  suite.run("transport/profile/lu_solve", 1, [&] {
+    airflownetwork::transport::matrix(0, profile, model.links);
+    profile.scale(-h);
+    for (Eigen::Index i = 0; i < n; ++i) {
+      profile.diagonal(i) += A[i] + h * R[i];
+    }
+  }, [&] {
+    profile.lu();
+    G1 = G;
+    profile.solve(G1);
+  });
+
+  std::vector<size_t> ill_posed;
+  suite.run("transport/steady_state", 1, [&] { system = base; }, [&] {
+    airflownetwork::transport::steady_state(solver, system, G, R, C, ill_posed);
+  });
+}
+
+int main(int argc, char* argv[])
+{
+  size_t warmup{ 2 };
+  size_t repetitions{ 10 };
+  airflownetwork::generator::Building building;
+  building.stories = 50;
+  building.zones_per_story = 20;
+  building.stairwells = 2;
+  building.shafts = 2;
+  building.duct_depth = 4;
+  building.duct_branching = 4;
+  size_t count{ 100000 };
+  std::string filter{ "*" };
+  std::string json;
+  std::string csv;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{ argv[i] };
+    if (i + 1 >= argc) {
+      std::cerr << "usage: benchmarks [--warmup N] [--repetitions N] [--stories N] [--zones N] [--count N] [--filter PATTERN] [--json FILE] [--csv FILE]"
+        << std::endl;
+      return 1;
+    }
+    std::string value{ argv[++i] };
+    if (arg == "--warmup") {
+      warmup = std::stoul(value);
+    } else if (arg == "--repetitions") {
+      repetitions = std::stoul(value);
+    } else if (arg == "--stories") {
+      building.stories = std::stoul(value);
+    } else if (arg == "--zones") {
+      building.zones_per_story = std::stoul(value);
+    } else if (arg == "--count") {
+      count = std::stoul(value);
+    } else if (arg == "--filter") {
+      filter = value;
+    } else if (arg == "--json") {
+      json = value;
+    } else if (arg == "--csv") {
+      csv = value;
+    } else {
+      std::cerr << "Unrecognized argument \"" << arg << '\"' << std::endl;
+      return 1;
+    }
+  }
+
+  airflownetwork::benchmark::Suite suite(warmup, repetitions, filter);
+
+  element_benchmarks(suite, count);
+
+  std::ostringstream stream;
+  airflownetwork::generator::generate(building).write_xml(stream);
+  std::string xml{ stream.str() };
+  pugi::xml_document doc;
+  doc.load_string(xml.c_str());
+  Model model("benchmark");
+  if (!model.load(doc.child("AirflowNetwork"))) {
+    for (auto& mesg : model.errors) {
+      std::cerr << mesg << std::endl;
+    }
+    return 1;
+  }
+  model.verbose = false;
+  model_benchmarks(suite, xml, model);
+  transport_benchmarks(suite, model);
+
+  suite.write_text(std::cout);
+  if (!json.empty()) {
+    std::ofstream file(json);
+    suite.write_json(file);
+  }
+  if (!csv.empty()) {
+    std::ofstream file(csv);
+    suite.write_csv(file);
+  }
+  return 0;
+}
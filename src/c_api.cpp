@@ -0,0 +1,487 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <string>
+#include <memory>
+#include <exception>
+#include "airflownetwork.h"
+#include "pugixml.hpp"
+#include "model.hpp"
+
+typedef airflownetwork::Model<airflownetwork::Index, airflownetwork::properties::AIRNET> Model;
+
+struct afn_model
+{
+  afn_model() : model("capi")
+  {
+    model.verbose = false;
+  }
+
+  Model model;
+};
+
+static thread_local std::string last_error;
+
+static void fail(const std::string& mesg) noexcept
+{
+  try {
+    last_error = mesg;
+  } catch (...) {
+    last_error.clear();
+  }
+}
+
+static void fail(const Model& model, const std::string& mesg) noexcept
+{
+  try {
+    last_error = mesg;
+    for (auto& error : model.errors) {
+      last_error += '\n' + error;
+    }
+  } catch (...) {
+    last_error.clear();
+  }
+}
+
+// Nothing may be thrown across the C interface, so every entry point runs its body through this and an
+// exception is reported like any other failure
+template <typename T, typename F> static T guard(T failure, F function) noexcept
+{
+  try {
+    return function();
+  } catch (const std::exception& exc) {
+    fail(exc.what());
+  } catch (...) {
+    fail("Unknown error");
+  }
+  return failure;
+}
+
+static afn_model* load(const pugi::xml_document& doc)
+{
+  auto root = doc.child("AirflowNetwork");
+  if (!root) {
+    fail("Failed to find root AirflowNetwork node");
+    return nullptr;
+  }
+  auto model = std::make_unique<afn_model>();
+  if (!model->model.load(root)) {
+    fail(model->model, "Failed to load AirflowNetwork model");
+    return nullptr;
+  }
+  return model.release();
+}
+
+static std::string name_of(const char* const* names, size_t i, const char* type)
+{
+  if (names && names[i]) {
+    return names[i];
+  }
+  return type + std::to_string(i);
+}
+
+extern "C" {
+
+const char* afn_last_error(void)
+{
+  return last_error.c_str();
+}
+
+afn_model* afn_create_from_xml_file(const char* filename)
+{
+  return guard(static_cast<afn_model*>(nullptr), [&]() -> afn_model* {
+    if (!filename) {
+      fail("No file name given");
+      return nullptr;
+    }
+    pugi::xml_document doc;
+    if (!doc.load_file(filename)) {
+      fail("Failed to load XML file \"" + std::string(filename) + "\"");
+      return nullptr;
+    }
+    return load(doc);
+  });
+}
+
+afn_model* afn_create_from_xml_string(const char* xml)
+{
+  return guard(static_cast<afn_model*>(nullptr), [&]() -> afn_model* {
+    if (!xml) {
+      fail("No XML given");
+      return nullptr;
+    }
+    pugi::xml_document doc;
+    if (!doc.load_string(xml)) {
+      fail("Failed to parse XML");
+      return nullptr;
+    }
+    return load(doc);
+  });
+}
+
+afn_model* afn_create(size_t node_count, const char* const* node_names, const int* node_types, const double* heights,
+  const double* pressures, const double* temperatures, size_t element_count, const char* const* element_names,
+  const double* coefficients, const double* exponents, size_t link_count, const char* const* link_names, const size_t* node0,
+  const size_t* node1, const size_t* elements)
+{
+  return guard(static_cast<afn_model*>(nullptr), [&]() -> afn_model* {
+    if (!node_types || !coefficients || !node0 || !node1 || !elements) {
+      fail("Node types, element coefficients, and link nodes and elements are required");
+      return nullptr;
+    }
+    auto model = std::make_unique<afn_model>();
+    auto& m = model->model;
+    bool success{ true };
+    for (size_t i = 0; i < element_count; ++i) {
+      double exponent{ exponents ? exponents[i] : 0.65 };
+      success &= m.add_powerlaw(name_of(element_names, i, "Element"), coefficients[i], coefficients[i], exponent).has_value();
+    }
+    for (size_t i = 0; i < node_count; ++i) {
+      airflownetwork::NodeType type;
+      switch (node_types[i]) {
+      case AFN_SIMULATED:
+        type = airflownetwork::NodeType::Simulated;
+        break;
+      case AFN_FIXED:
+        type = airflownetwork::NodeType::Fixed;
+        break;
+      case AFN_CALCULATED:
+        type = airflownetwork::NodeType::Calculated;
+        break;
+      default:
+        fail("Node " + std::to_string(i) + " has unknown type " + std::to_string(node_types[i]));
+        return nullptr;
+      }
+      success &= m.add_node(name_of(node_names, i, "Node"), type, heights ? heights[i] : 0.0,
+        pressures ? pressures[i] : airflownetwork::properties::AIRNET::pressure_0,
+        temperatures ? temperatures[i] : airflownetwork::properties::AIRNET::temperature_0).has_value();
+    }
+    if (!success) {
+      fail(m, "Failed to create nodes and elements");
+      return nullptr;
+    }
+    for (size_t i = 0; i < link_count; ++i) {
+      success &= m.add_link(name_of(link_names, i, "Link"), static_cast<airflownetwork::Index>(node0[i]),
+        static_cast<airflownetwork::Index>(node1[i]), static_cast<airflownetwork::Index>(elements[i])).has_value();
+    }
+    if (!success || !m.setup()) {
+      fail(m, "Failed to create links");
+      return nullptr;
+    }
+    return model.release();
+  });
+}
+
+void afn_destroy(afn_model* model)
+{
+  delete model;
+}
+
+size_t afn_node_count(const afn_model* model)
+{
+  return guard(size_t{ 0 }, [&]() -> size_t {
+    return model ? model->model.node_count() : 0;
+  });
+}
+
+size_t afn_link_count(const afn_model* model)
+{
+  return guard(size_t{ 0 }, [&]() -> size_t {
+    return model ? model->model.links.size() : 0;
+  });
+}
+
+int afn_find_node(const afn_model* model, const char* name, size_t* node)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !name || !node) {
+      fail("Invalid argument to afn_find_node");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto found = model->model.find_node(name);
+    if (!found) {
+      fail("No node named \"" + std::string(name) + "\"");
+      return AFN_BAD_ARGUMENT;
+    }
+    *node = found.value();
+    return AFN_OK;
+  });
+}
+
+int afn_find_link(const afn_model* model, const char* name, size_t* link)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !name || !link) {
+      fail("Invalid argument to afn_find_link");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto found = model->model.find_link(name);
+    if (!found) {
+      fail("No link named \"" + std::string(name) + "\"");
+      return AFN_BAD_ARGUMENT;
+    }
+    *link = found.value();
+    return AFN_OK;
+  });
+}
+
+int afn_link_nodes(const afn_model* model, size_t link, size_t* node0, size_t* node1)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || link >= model->model.links.size() || !node0 || !node1) {
+      fail("Invalid argument to afn_link_nodes");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& m = model->model;
+    auto& el = m.links[link];
+    *node0 = m.find_node(m.names[el.node0.name]).value();
+    *node1 = m.find_node(m.names[el.node1.name]).value();
+    return AFN_OK;
+  });
+}
+
+int afn_set_node_state(afn_model* model, size_t node, double pressure, double temperature, double humidity_ratio)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || node >= model->model.node_count()) {
+      fail("Invalid argument to afn_set_node_state");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& el = model->model.node(static_cast<airflownetwork::Index>(node));
+    el.pressure = pressure;
+    el.temperature = temperature;
+    el.humidity_ratio = humidity_ratio;
+    el.update();
+    return AFN_OK;
+  });
+}
+
+int afn_set_node_pressures(afn_model* model, size_t count, const size_t* nodes, const double* pressures)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || (count > 0 && (!nodes || !pressures))) {
+      fail("Invalid argument to afn_set_node_pressures");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& m = model->model;
+    for (size_t i = 0; i < count; ++i) {
+      if (nodes[i] >= m.node_count()) {
+        fail("Node " + std::to_string(nodes[i]) + " does not exist");
+        return AFN_BAD_ARGUMENT;
+      }
+      auto& node = m.node(static_cast<airflownetwork::Index>(nodes[i]));
+      node.pressure = pressures[i];
+      node.update();
+    }
+    return AFN_OK;
+  });
+}
+
+int afn_set_link_control(afn_model* model, size_t link, double control)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || link >= model->model.links.size()) {
+      fail("Invalid argument to afn_set_link_control");
+      return AFN_BAD_ARGUMENT;
+    }
+    model->model.links[link].control = control;
+    return AFN_OK;
+  });
+}
+
+int afn_set_link_controls(afn_model* model, const double* controls)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !controls) {
+      fail("Invalid argument to afn_set_link_controls");
+      return AFN_BAD_ARGUMENT;
+    }
+    size_t k{ 0 };
+    for (auto& link : model->model.links) {
+      link.control = controls[k++];
+    }
+    return AFN_OK;
+  });
+}
+
+int afn_set_tolerance(afn_model* model, double tolerance, int max_iterations)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || tolerance <= 0.0 || max_iterations < 1) {
+      fail("Invalid argument to afn_set_tolerance");
+      return AFN_BAD_ARGUMENT;
+    }
+    model->model.tolerance = tolerance;
+    model->model.set_max_iterations(max_iterations);
+    return AFN_OK;
+  });
+}
+
+int afn_solve(afn_model* model)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model) {
+      fail("Invalid argument to afn_solve");
+      return AFN_BAD_ARGUMENT;
+    }
+    if (!model->model.steady_solve()) {
+      fail("Steady solve did not converge in " + std::to_string(model->model.max_iterations) + " iterations");
+      return AFN_NOT_CONVERGED;
+    }
+    return AFN_OK;
+  });
+}
+
+int afn_get_pressures(const afn_model* model, double* pressures, size_t size)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !pressures || size < model->model.node_count()) {
+      fail("Invalid argument to afn_get_pressures");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& m = model->model;
+    for (size_t i = 0; i < m.node_count(); ++i) {
+      pressures[i] = m.node(static_cast<airflownetwork::Index>(i)).pressure;
+    }
+    return AFN_OK;
+  });
+}
+
+int afn_get_flows(const afn_model* model, double* flows, size_t size)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !flows || size < model->model.links.size()) {
+      fail("Invalid argument to afn_get_flows");
+      return AFN_BAD_ARGUMENT;
+    }
+    size_t k{ 0 };
+    for (auto& link : model->model.links) {
+      flows[k++] = link.flow;
+    }
+    return AFN_OK;
+  });
+}
+
+const double* afn_pressure_data(const afn_model* model)
+{
+  return guard(static_cast<const double*>(nullptr), [&]() -> const double* {
+    return model ? model->model.p.data() : nullptr;
+  });
+}
+
+const double* afn_flow_data(const afn_model* model)
+{
+  return guard(static_cast<const double*>(nullptr), [&]() -> const double* {
+    return model ? model->model.link_flows().data() : nullptr;
+  });
+}
+
+int afn_node_indices(const afn_model* model, size_t* indices, size_t size)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || !indices || size < model->model.node_count()) {
+      fail("Invalid argument to afn_node_indices");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& m = model->model;
+    for (size_t i = 0; i < m.node_count(); ++i) {
+      indices[i] = m.node(static_cast<airflownetwork::Index>(i)).index;
+    }
+    return AFN_OK;
+  });
+}
+
+int afn_set_species_count(afn_model* model, size_t count)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model) {
+      fail("Invalid argument to afn_set_species_count");
+      return AFN_BAD_ARGUMENT;
+    }
+    auto& m = model->model;
+    for (size_t i = 0; i < m.node_count(); ++i) {
+      m.node(static_cast<airflownetwork::Index>(i)).concentrations.resize(count, 0.0);
+    }
+    return AFN_OK;
+  });
+}
+
+double* afn_concentration_data(afn_model* model, size_t node, size_t* count)
+{
+  return guard(static_cast<double*>(nullptr), [&]() -> double* {
+    if (!model || node >= model->model.node_count()) {
+      fail("Invalid argument to afn_concentration_data");
+      return nullptr;
+    }
+    auto& concentrations = model->model.node(static_cast<airflownetwork::Index>(node)).concentrations;
+    if (count) {
+      *count = concentrations.size();
+    }
+    return concentrations.data();
+  });
+}
+
+int afn_solve_batch(afn_model* model, size_t cases, size_t count, const size_t* nodes, const double* pressures,
+  const double* controls, double* out_pressures, double* out_flows, int* status)
+{
+  return guard<int>(AFN_ERROR, [&]() -> int {
+    if (!model || (count > 0 && (!nodes || !pressures))) {
+      fail("Invalid argument to afn_solve_batch");
+      return AFN_BAD_ARGUMENT;
+    }
+    size_t node_count{ afn_node_count(model) };
+    size_t link_count{ afn_link_count(model) };
+    int result{ AFN_OK };
+    for (size_t i = 0; i < cases; ++i) {
+      int code = afn_set_node_pressures(model, count, nodes, pressures + i * count);
+      if (code == AFN_OK && controls) {
+        code = afn_set_link_controls(model, controls + i * link_count);
+      }
+      if (code == AFN_OK) {
+        code = afn_solve(model);
+      }
+      if (status) {
+        status[i] = code;
+      }
+      if (code == AFN_BAD_ARGUMENT || code == AFN_ERROR) {
+        return code;
+      }
+      if (code == AFN_NOT_CONVERGED) {
+        result = AFN_NOT_CONVERGED;
+      }
+      if (out_pressures) {
+        afn_get_pressures(model, out_pressures + i * node_count, node_count);
+      }
+      if (out_flows) {
+        afn_get_flows(model, out_flows + i * link_count, link_count);
+      }
+    }
+    return result;
+  });
+}
+
+}
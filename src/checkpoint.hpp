@@ -0,0 +1,155 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_CHECKPOINT_HPP
+#define AIRFLOWNETWORK_CHECKPOINT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace airflownetwork {
+namespace checkpoint {
+
+// Checkpoints are raw native-endian binary, they are meant for restarting on the same kind of machine
+const char magic[8]{ 'A', 'F', 'N', 'C', 'H', 'K', 0, 0 };
+const std::uint32_t version{ 1 };
+
+// FNV-1a, used to make sure that a checkpoint is restored into the same model that wrote it
+inline std::uint64_t hash(std::string_view string, std::uint64_t value = 14695981039346656037ull)
+{
+  for (unsigned char c : string) {
+    value ^= c;
+    value *= 1099511628211ull;
+  }
+  // Separate consecutive strings so that "ab","c" and "a","bc" differ
+  value ^= 0xff;
+  value *= 1099511628211ull;
+  return value;
+}
+
+struct Writer
+{
+  Writer(std::ostream& stream) : stream(stream)
+  {}
+
+  template <typename T> void write(const T& value)
+  {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T> void write(const std::vector<T>& values)
+  {
+    write(static_cast<std::uint64_t>(values.size()));
+    if (!values.empty()) {
+      stream.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+    }
+  }
+
+  bool good() const
+  {
+    return stream.good();
+  }
+
+  std::ostream& stream;
+};
+
+struct Reader
+{
+  Reader(std::istream& stream) : stream(stream)
+  {}
+
+  template <typename T> bool read(T& value)
+  {
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return stream.good();
+  }
+
+  // Bytes left in the stream, used to reject corrupt lengths before allocating for them
+  std::uint64_t remaining()
+  {
+    auto position = stream.tellg();
+    if (position < 0) {
+      return 0;
+    }
+    stream.seekg(0, std::ios::end);
+    auto end = stream.tellg();
+    stream.seekg(position);
+    return static_cast<std::uint64_t>(end - position);
+  }
+
+  // Read a count of items of the given size, failing if the stream can't hold that many
+  bool read_count(std::uint64_t& count, size_t item_size)
+  {
+    return read(count) && count <= remaining() / item_size;
+  }
+
+  template <typename T> bool read(std::vector<T>& values)
+  {
+    std::uint64_t size;
+    if (!read_count(size, sizeof(T))) {
+      return false;
+    }
+    values.resize(size);
+    if (size > 0) {
+      stream.read(reinterpret_cast<char*>(values.data()), sizeof(T) * size);
+    }
+    return stream.good();
+  }
+
+  // Read into an existing array without resizing it, the sizes must match
+  template <typename T> bool read_fixed(std::vector<T>& values)
+  {
+    std::uint64_t size;
+    if (!read(size) || size != values.size()) {
+      return false;
+    }
+    if (size > 0) {
+      stream.read(reinterpret_cast<char*>(values.data()), sizeof(T) * size);
+    }
+    return stream.good();
+  }
+
+  std::istream& stream;
+};
+
+}
+
+// Dynamic state that lives outside of the model but needs to be saved with it
+struct Checkpoint
+{
+  double time{ 0.0 };
+  std::vector<std::uint64_t> cursors;       // Schedule positions and other counters owned by the caller
+  std::vector<std::vector<double>> vectors; // Transport vectors and other arrays owned by the caller
+};
+
+}
+
+#endif // !AIRFLOWNETWORK_CHECKPOINT_HPP
@@ -0,0 +1,78 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_CONVERGENCE_HPP
+#define AIRFLOWNETWORK_CONVERGENCE_HPP
+
+#include <vector>
+#include <cstdint>
+#include "names.hpp"
+
+namespace airflownetwork {
+namespace convergence {
+
+struct Iteration
+{
+  unsigned iteration;
+  double residual_norm; // 2-norm of the mass flow residuals [kg/s]
+  double residual_max;
+  Name node; // Node with the largest residual
+  double correction_max; // Largest pressure correction applied [Pa], zero when the iteration converged
+};
+
+// Convergence history of the last steady solve. The storage is sized by the model's setup, so
+// recording doesn't allocate memory.
+struct History
+{
+  void reset(size_t links)
+  {
+    iterations.clear();
+    sign_changes.assign(links, 0);
+    converged = false;
+  }
+
+  // Links (by index) whose flow changed direction at least threshold times during the solve
+  std::vector<size_t> oscillating(unsigned threshold = 3) const
+  {
+    std::vector<size_t> result;
+    for (size_t k = 0; k < sign_changes.size(); ++k) {
+      if (sign_changes[k] >= threshold) {
+        result.push_back(k);
+      }
+    }
+    return result;
+  }
+
+  std::vector<Iteration> iterations;
+  std::vector<unsigned> sign_changes; // Number of flow reversals for each link, in link order
+  bool converged{ false };
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_CONVERGENCE_HPP
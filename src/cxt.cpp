@@ -49,7 +49,7 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  airflownetwork::Model<size_t, airflownetwork::properties::AIRNET> model("main");
+  airflownetwork::Model<airflownetwork::Index, airflownetwork::properties::AIRNET> model("main");
   if (!model.load(afn)) {
     std::cerr << "Failed to load AirflowNetwork model" << std::endl;
     for (auto& mesg : model.errors) {
@@ -62,7 +62,7 @@ int main(int argc, char* argv[])
   std::cout << "Elements ------------- " << std::endl;
   for (auto& el : model.powerlaw_elements) {
     ++element_count;
-    std::cout << "\tPower Law:" << el.name << std::endl;
+    std::cout << "\tPower Law:" << model.names[el.name] << std::endl;
   }
   std::cout << "Found " << element_count << " Element(s)" << std::endl;
 
@@ -70,22 +70,22 @@ int main(int argc, char* argv[])
   std::cout << "Materials ------------ " << std::endl;
   for (auto& el : model.materials) {
     ++material_count;
-    std::cout << "\tMaterial:" << el.name << std::endl;
+    std::cout << "\tMaterial:" << model.names[el.name] << std::endl;
   }
   std::cout << "Found " << material_count << " Material(s)" << std::endl;
 
   int node_count = 0;
   std::cout << "Nodes ---------------- " << std::endl;
   for (auto& el : model.simulated_nodes) {
-    std::cout << "\tSimulated:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tSimulated:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   for (auto& el : model.fixed_nodes) {
-    std::cout << "\tFixed:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tFixed:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   for (auto& el : model.calculated_nodes) {
-    std::cout << "\tCalculated:" << el.name << " [" << el.index << ']' << std::endl;
+    std::cout << "\tCalculated:" << model.names[el.name] << " [" << el.index << ']' << std::endl;
     ++node_count;
   }
   /*
@@ -114,8 +114,8 @@ int main(int argc, char* argv[])
   std::cout << "Links ---------------- " << std::endl;
   for (auto& el : model.links) {
     ++link_count;
-    std::cout << '\t' << el.name << '(' << el.node0.name << "--" << el.element.name << "-->" << el.node1.name << "), ["
-      << el.index0 << ',' << el.index1 << ']' << std::endl;
+    std::cout << '\t' << model.names[el.name] << '(' << model.names[el.node0.name] << "--" << model.names[el.element.name] << "-->"
+      << model.names[el.node1.name] << "), [" << el.index0 << ',' << el.index1 << ']' << std::endl;
   }
 
   std::cout << "Found " << link_count << " Link(s)" << std::endl;
@@ -128,8 +128,8 @@ int main(int argc, char* argv[])
   }
 
   // Read in flow results
-  airflownetwork::Results<airflownetwork::Link<size_t, airflownetwork::properties::AIRNET>> results;
-  results.load(afn, model.links);
+  airflownetwork::Results<airflownetwork::Link<airflownetwork::Index, airflownetwork::properties::AIRNET>> results;
+  results.load(afn, model.links, model.names);
 
   for (auto& mesg : results.errors) {
     std::cerr << mesg << std::endl;
@@ -140,7 +140,7 @@ int main(int argc, char* argv[])
     int count{ 0 };
     for (auto& el : results.link_flows[0].results) {
       ++count;
-      std::cout << '\t' << count << ' ' << el.object.name << ' ' << el.flow << std::endl;
+      std::cout << '\t' << count << ' ' << model.names[el.object.name] << ' ' << el.flow << std::endl;
     }
 
     results.link_flows[0].apply();
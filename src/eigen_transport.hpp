@@ -32,7 +32,12 @@
 #include <vector>
 #include <type_traits>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Eigen/SparseLU"
 #include "filters.hpp"
+#include "sparsity.hpp"
 
 namespace airflownetwork {
 namespace transport {
@@ -40,37 +45,24 @@ namespace transport {
 template <typename L, typename M, typename K> void matrix(const K& key, M& matrix, L& links)
 {
   for (auto& link : links) {
-    // Compute the inefficiency
-    double ineff = 1.0;
-    for (auto& filter : link.filters[key]) {
-      // Expect filters found via a key, get the combined efficiency with a schedule value
-      double eff = filter.efficiency * filter.control;
-      if (eff == 1.0) {
-        // Nothing is going to be transported
-        // link.active = false;
-        goto inactive;
+    auto i = link.node0.index;
+    auto j = link.node1.index;
+    for_each_flux(link, key, [&](auto entry, double value) {
+      switch (entry) {
+      case Flux::Diagonal0:
+        matrix.coeffRef(i, i) += value;
+        break;
+      case Flux::Diagonal1:
+        matrix.coeffRef(j, j) += value;
+        break;
+      case Flux::Lower:
+        matrix.coeffRef(j, i) += value;
+        break;
+      case Flux::Upper:
+        matrix.coeffRef(i, j) += value;
+        break;
       }
-      ineff *= (1.0 - eff);
-    }
-    if (link.nf == 1) {
-      if (link.flow > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node0.index) -= link.flow; // This is a diagonal entry
-        matrix.coeffRef(link.node1.index, link.node0.index) += link.flow * ineff;
-      } else if (link.flow < 0) {
-        matrix.coeffRef(link.node0.index, link.node1.index) -= link.flow * ineff;
-        matrix.coeffRef(link.node1.index, link.node1.index) += link.flow; // This is a diagonal entry
-      }
-    } else if (link.nf == 2) { // This is not tested yet
-      if (link.flow0 > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node0.index) -= link.flow0; // This is a diagonal entry
-        matrix.coeffRef(link.node1.index, link.node0.index) += link.flow0 * ineff;
-      }
-      if (link.flow1 > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node1.index) += link.flow1 * ineff;
-        matrix.coeffRef(link.node1.index, link.node1.index) -= link.flow1; // This is a diagonal entry
-      }
-    }
-  inactive:;
+    });
   }
 }
 
@@ -106,6 +98,147 @@ template <typename S, typename M, typename V> void crank_nicolson(S& solver, dou
   C = solver.solve(G);
 }
 
+// Smallest pivot magnitude of a factorization, solvers that don't expose their pivots are trusted
+template <typename S> double smallest_pivot(const S&)
+{
+  return std::numeric_limits<double>::infinity();
+}
+
+// SparseLU stores the diagonal blocks of U with L, see SparseLU::absDeterminant()
+template <typename T, typename O> double smallest_pivot(const Eigen::SparseLU<T, O>& solver)
+{
+  auto factors = solver.matrixL();
+  typedef typename std::decay<decltype(factors.m_mapL)>::type Factors;
+  double smallest{ std::numeric_limits<double>::infinity() };
+  for (Eigen::Index j = 0; j < solver.cols(); ++j) {
+    for (typename Factors::InnerIterator it(factors.m_mapL, j); it; ++it) {
+      if (it.index() == j) {
+        smallest = std::min(smallest, std::abs(it.value()));
+        break;
+      }
+    }
+  }
+  return smallest;
+}
+
+// Solve directly for the steady state concentrations, (M - R) C = -G. The matrix must have all of its
+// diagonal entries (e.g. set up with a transport::Pattern) and is modified. There is no steady state if
+// contaminant can get into a node and never leave the system, which is the case for every node from which
+// following the flows never gets to removal, a filter, or flow out of the system. These nodes (including
+// those in closed recirculation loops) are listed in ill_posed and the solve is not done. The solve also
+// fails if a pivot is tiny compared to the diagonal.
+template <typename S, typename M, typename V, typename I> bool steady_state(S& solver, M& matrix, const V& G, const V& R, V& C,
+  std::vector<I>& ill_posed, double tolerance = 1.0e-12)
+{
+  typedef typename M::StorageIndex Index;
+  ill_posed.clear();
+  Index n{ static_cast<Index>(matrix.outerSize()) };
+  for (Index j = 0; j < n; ++j) {
+    matrix.coeffRef(j, j) -= R[j];
+  }
+  // Material leaves the system from the nodes whose column sums are negative, work back along the flows
+  // from those to find every node that drains
+  std::vector<bool> drains(n, false);
+  std::vector<Index> stack;
+  double scale{ 0.0 };
+  for (Index j = 0; j < n; ++j) {
+    double sum{ 0.0 };
+    double diagonal{ 0.0 };
+    for (typename M::InnerIterator it(matrix, j); it; ++it) {
+      sum += it.value();
+      if (it.row() == j) {
+        diagonal = it.value();
+      }
+    }
+    scale = std::max(scale, std::abs(diagonal));
+    if (sum < -tolerance * std::abs(diagonal)) {
+      drains[j] = true;
+      stack.push_back(j);
+    }
+  }
+  M transposed = matrix.transpose();
+  while (!stack.empty()) {
+    Index i{ stack.back() };
+    stack.pop_back();
+    for (typename M::InnerIterator it(transposed, i); it; ++it) {
+      Index j{ static_cast<Index>(it.row()) };
+      if (j != i && it.value() > 0.0 && !drains[j]) {
+        drains[j] = true;
+        stack.push_back(j);
+      }
+    }
+  }
+  for (Index j = 0; j < n; ++j) {
+    if (!drains[j]) {
+      ill_posed.push_back(static_cast<I>(j));
+    }
+  }
+  if (!ill_posed.empty()) {
+    return false;
+  }
+  solver.compute(matrix);
+  if (solver.info() != Eigen::Success || smallest_pivot(solver) <= tolerance * scale) {
+    return false;
+  }
+  C = solver.solve(-G);
+  return solver.info() == Eigen::Success;
+}
+
+// Group the species keys that see the same filter inefficiency on every link, each group shares a
+// transport matrix and can be solved with one factorization. A key past the end of a link's filter
+// list is treated as unfiltered on that link.
+template <typename L, typename K> std::vector<std::vector<K>> group_species(const std::vector<K>& keys, L& links)
+{
+  std::vector<std::vector<K>> groups;
+  std::vector<std::vector<double>> signatures;
+  for (auto& key : keys) {
+    std::vector<double> signature;
+    for (auto& link : links) {
+      signature.push_back(static_cast<size_t>(key) < link.filters.size() ? inefficiency(link.filters[key]) : 1.0);
+    }
+    auto found = std::find(signatures.begin(), signatures.end(), signature);
+    if (found == signatures.end()) {
+      groups.push_back({ key });
+      signatures.push_back(std::move(signature));
+    } else {
+      groups[found - signatures.begin()].push_back(key);
+    }
+  }
+  return groups;
+}
+
+// Block versions of the implicit methods, the columns of the G and C blocks are species that share the
+// matrix and the removal rates, so the matrix is only factored once for all of them
+
+template <typename S, typename M, typename V, typename B> void implicit_euler_block(S& solver, double h, M& matrix, B& G, V& R, V& A,
+  B& C)
+{
+  // Set up
+  matrix *= -h;
+  matrix += (A + h * R).asDiagonal();
+  solver.compute(matrix);
+  // Solve
+  G *= h;
+  G += A.asDiagonal() * C;
+  C = solver.solve(G);
+}
+
+template <typename S, typename M, typename V, typename B> void crank_nicolson_block(S& solver, double h, M& matrix, B& G0, B& G, V& R0,
+  V& R, V& A0, V& A, B& C)
+{
+  h *= 0.5;
+  B hH = h * (matrix * C - R0.asDiagonal() * C + G0);
+  // Set up
+  matrix *= -h;
+  matrix += (A + h * R).asDiagonal();
+  solver.compute(matrix);
+  // Solve
+  G *= h;
+  G += A0.asDiagonal() * C;
+  G += hH;
+  C = solver.solve(G);
+}
+
 }
 
 }
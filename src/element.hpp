@@ -31,6 +31,7 @@
 #include <string>
 #include <array>
 #include "properties.hpp"
+#include "names.hpp"
 
 #define TOKELVIN(T) (T+273.15)
 
@@ -525,10 +526,10 @@ template<typename P> void generic_crack0(bool const laminar, // Initialization f
 
 template <typename P> struct Element
 {
-  Element(const std::string& name) : name(name)
+  Element(Name name) : name(name)
   {}
 
-  const std::string name;
+  const Name name;
 
   virtual int calculate(bool laminar,  // Initialization flag.If = 1, use laminar relationship
     double pdrop,                      // Total pressure drop across a component (P1 - P2) [Pa]
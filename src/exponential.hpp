@@ -0,0 +1,196 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_EXPONENTIAL_HPP
+#define AIRFLOWNETWORK_EXPONENTIAL_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "Eigen/Dense"
+#include "Eigen/SparseCore"
+#include "unsupported/Eigen/MatrixFunctions"
+
+namespace airflownetwork {
+namespace transport {
+
+// Exponential integrator for transport with constant coefficients. Over an interval with constant flows,
+// removal, and generation, A dC/dt = M C - R C + G is solved exactly by
+//
+//   C(t + h) = exp(h K) C(t) + h phi1(h K) b, with K = A^-1 (M - R) and b = A^-1 G
+//
+// The generation term is folded into one extra row and column, and the action of the exponential of
+// the augmented matrix is computed with Krylov subspace projections. The interval is split only if the
+// Krylov error estimate requires it, there is no stability limit.
+//
+// The Krylov basis, the projected matrix and its exponential, and the work vectors are allocated on
+// construction. The exponential of the small projected matrix is computed with Eigen's MatrixFunctions,
+// which does allocate its own temporaries, so unlike the implicit steppers this one is never
+// allocation-free.
+template <typename M, typename V> class ExponentialStepper
+{
+public:
+  ExponentialStepper(const M& base, int dimension = 30, double tolerance = 1.0e-10, std::uint64_t version = 0,
+    std::uint64_t filter_version = 0) : tolerance(tolerance), m_base(base), m_version(version), m_filter_version(filter_version)
+  {
+    auto n = base.rows();
+    m_dimension = static_cast<int>(std::min<decltype(n)>(dimension, n + 1));
+    m_basis.resize(n + 1, m_dimension + 1);
+    m_hessenberg.resize(m_dimension + 1, m_dimension + 1);
+    m_exponential.resize(m_dimension, m_dimension);
+    m_w.resize(n + 1);
+    m_v.resize(n);
+  }
+
+  // Replace the flow matrix, which should have the same structure as the original, nothing is copied
+  // if neither the flow nor the filter version has changed (see Stepper)
+  void set_base(const M& base, std::uint64_t version, std::uint64_t filter_version)
+  {
+    if (version == m_version && filter_version == m_filter_version) {
+      return;
+    }
+    std::copy(base.valuePtr(), base.valuePtr() + base.nonZeros(), m_base.valuePtr());
+    m_version = version;
+    m_filter_version = filter_version;
+  }
+
+  std::uint64_t version() const
+  {
+    return m_version;
+  }
+
+  std::uint64_t filter_version() const
+  {
+    return m_filter_version;
+  }
+
+  // Advance the concentrations over an interval with constant coefficients, the concentrations are left
+  // alone if the projection breaks down (e.g. a zero capacity) or no substep meets the tolerance
+  bool step(double h, const V& G, const V& R, const V& A, V& C)
+  {
+    auto n = C.size();
+    m_w.head(n) = C;
+    m_w[n] = 1.0;
+    double t{ 0.0 };
+    double tau{ h };
+    m_substeps = 0;
+    while (t < h) {
+      tau = std::min(tau, h - t);
+      double beta = m_w.norm();
+      if (beta == 0.0) {
+        break;
+      }
+      // Arnoldi
+      m_hessenberg.setZero();
+      m_basis.col(0) = m_w / beta;
+      int m{ m_dimension };
+      double residual{ 0.0 };
+      for (int j = 0; j < m_dimension; ++j) {
+        apply(m_basis.col(j), G, R, A, m_basis.col(j + 1));
+        for (int i = 0; i <= j; ++i) {
+          m_hessenberg(i, j) = m_basis.col(i).dot(m_basis.col(j + 1));
+          m_basis.col(j + 1) -= m_hessenberg(i, j) * m_basis.col(i);
+        }
+        residual = m_basis.col(j + 1).norm();
+        if (residual <= 1.0e-12 * beta) {
+          // Happy breakdown, the subspace is invariant and the projection is exact
+          m = j + 1;
+          residual = 0.0;
+          break;
+        }
+        m_hessenberg(j + 1, j) = residual;
+        m_basis.col(j + 1) /= residual;
+      }
+      if (!std::isfinite(residual) || !m_hessenberg.topLeftCorner(m, m).allFinite()) {
+        return false;
+      }
+      // Find a substep that meets the tolerance
+      auto E = m_exponential.topLeftCorner(m, m);
+      int halvings{ 0 };
+      while (true) {
+        E = (tau * m_hessenberg.topLeftCorner(m, m)).exp();
+        double error = beta * residual * std::abs(E(m - 1, 0)) * tau;
+        if (error <= tolerance * std::max(1.0, beta) || residual == 0.0) {
+          break;
+        }
+        if (++halvings > max_halvings) {
+          return false;
+        }
+        tau *= 0.5;
+      }
+      m_w.noalias() = m_basis.leftCols(m) * E.col(0);
+      m_w *= beta;
+      t += tau;
+      ++m_substeps;
+      // Try a bigger step next time
+      tau *= 2.0;
+    }
+    if (!m_w.allFinite()) {
+      return false;
+    }
+    C = m_w.head(n);
+    return true;
+  }
+
+  // Number of Krylov projections used in the last step
+  int substeps() const
+  {
+    return m_substeps;
+  }
+
+  double tolerance;
+
+private:
+  // Augmented operator, y = [K x + b x_n, 0]
+  template <typename X, typename Y> void apply(const X& x, const V& G, const V& R, const V& A, Y&& y)
+  {
+    auto n = m_v.size();
+    m_v.noalias() = m_base * x.head(n);
+    m_v -= R.cwiseProduct(x.head(n));
+    m_v += x[n] * G;
+    y.head(n) = m_v.cwiseQuotient(A);
+    y[n] = 0.0;
+  }
+
+  static constexpr int max_halvings{ 60 };
+
+  M m_base;
+  Eigen::MatrixXd m_basis;
+  Eigen::MatrixXd m_hessenberg;
+  Eigen::MatrixXd m_exponential;
+  Eigen::VectorXd m_w;
+  V m_v;
+  std::uint64_t m_version;
+  std::uint64_t m_filter_version;
+  int m_dimension;
+  int m_substeps{ 0 };
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_EXPONENTIAL_HPP
@@ -30,6 +30,7 @@
 
 #include <string>
 #include <vector>
+#include <type_traits>
 #include "properties.hpp"
 
 namespace airflownetwork {
@@ -44,6 +45,69 @@ struct Filter
   double control;
 };
 
+// Combined inefficiency of a set of filters, negative if nothing gets through
+inline double inefficiency(const std::vector<Filter>& filters)
+{
+  double ineff = 1.0;
+  for (auto& filter : filters) {
+    double eff = filter.efficiency * filter.control;
+    if (eff == 1.0) {
+      return -1.0;
+    }
+    ineff *= (1.0 - eff);
+  }
+  return ineff;
+}
+
+namespace transport {
+
+// The transport matrix entries that a link contributes to, named as in the matrix for node 0 and node 1
+enum class Flux { Diagonal0, Diagonal1, Lower, Upper }; // (0,0), (1,1), (1,0), (0,1)
+
+// The entry is passed as a type so that each use of a callback is resolved at compile time
+template <Flux E> using FluxEntry = std::integral_constant<Flux, E>;
+
+// Pass each of a link's transport matrix contributions to add(entry, value), given the pass-through
+// factor of its filters. This is the one place that turns link flows into matrix entries, the matrix
+// functions for the different storage formats only differ in how they locate the entries.
+template <typename L, typename F> inline void for_each_flux_with(const L& link, double ineff, F&& add)
+{
+  if (ineff < 0.0) {
+    // Nothing is going to be transported
+    return;
+  }
+  // Flow from node 0 into node 1 and from node 1 into node 0, only one of them is nonzero for a single flow
+  double forward{ 0.0 };
+  double backward{ 0.0 };
+  if (link.nf == 1) {
+    if (link.flow > 0.0) {
+      forward = link.flow;
+    } else if (link.flow < 0) {
+      backward = -link.flow;
+    }
+  } else if (link.nf == 2) {
+    forward = link.flow0;
+    backward = link.flow1;
+  }
+  if (forward > 0.0) {
+    add(FluxEntry<Flux::Diagonal0>(), -forward);
+    add(FluxEntry<Flux::Lower>(), forward * ineff);
+  }
+  if (backward > 0.0) {
+    add(FluxEntry<Flux::Upper>(), backward * ineff);
+    add(FluxEntry<Flux::Diagonal1>(), -backward);
+  }
+}
+
+// As above, with the pass-through factor computed from the link's filters for a species key. A key past
+// the end of the link's filter list is unfiltered.
+template <typename L, typename K, typename F> inline void for_each_flux(const L& link, const K& key, F&& add)
+{
+  for_each_flux_with(link, static_cast<size_t>(key) < link.filters.size() ? inefficiency(link.filters[key]) : 1.0, add);
+}
+
+}
+
 /*
 template <typename L> struct Flow
 {
@@ -0,0 +1,93 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "generator.hpp"
+
+int main(int argc, char* argv[])
+{
+  airflownetwork::generator::Building building;
+  std::string filename;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{ argv[i] };
+    if (i + 1 >= argc) {
+      filename = arg;
+      break;
+    }
+    std::string value{ argv[++i] };
+    if (arg == "--stories") {
+      building.stories = std::stoul(value);
+    } else if (arg == "--zones") {
+      building.zones_per_story = std::stoul(value);
+    } else if (arg == "--stairwells") {
+      building.stairwells = std::stoul(value);
+    } else if (arg == "--shafts") {
+      building.shafts = std::stoul(value);
+    } else if (arg == "--duct-depth") {
+      building.duct_depth = std::stoul(value);
+    } else if (arg == "--duct-branching") {
+      building.duct_branching = std::stoul(value);
+    } else if (arg == "--cracks") {
+      building.cracks_per_zone = std::stoul(value);
+    } else if (arg == "--wind") {
+      building.wind_pressure = std::stod(value);
+    } else if (arg == "--seed") {
+      building.seed = std::stoul(value);
+    } else if (arg == "--ordering") {
+      if (value == "natural") {
+        building.ordering = airflownetwork::generator::Ordering::Natural;
+      } else if (value == "reversed") {
+        building.ordering = airflownetwork::generator::Ordering::Reversed;
+      } else if (value == "random") {
+        building.ordering = airflownetwork::generator::Ordering::Random;
+      } else {
+        std::cerr << "Unrecognized ordering \"" << value << '\"' << std::endl;
+        return 1;
+      }
+    } else {
+      std::cerr << "Unrecognized argument \"" << arg << '\"' << std::endl;
+      return 1;
+    }
+  }
+  if (filename.empty()) {
+    std::cerr << "usage: generate [--stories N] [--zones N] [--stairwells N] [--shafts N] [--duct-depth N] [--duct-branching N] [--cracks N]"
+      " [--wind PA] [--ordering natural|reversed|random] [--seed N] output.xml" << std::endl;
+    return 1;
+  }
+
+  auto network = airflownetwork::generator::generate(building);
+  std::ofstream file(filename);
+  if (!file) {
+    std::cerr << "Failed to open \"" << filename << '\"' << std::endl;
+    return 1;
+  }
+  network.write_xml(file);
+  std::cout << "Wrote " << network.nodes.size() << " nodes and " << network.links.size() << " links to " << filename << std::endl;
+  return 0;
+}
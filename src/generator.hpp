@@ -0,0 +1,277 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_GENERATOR_HPP
+#define AIRFLOWNETWORK_GENERATOR_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <limits>
+#include "node.hpp"
+
+namespace airflownetwork {
+namespace generator {
+
+enum class Ordering { Natural, Reversed, Random };
+
+// Parameters of a synthetic multi-story building
+struct Building
+{
+  unsigned stories{ 3 };
+  unsigned zones_per_story{ 4 };
+  unsigned stairwells{ 1 };
+  unsigned shafts{ 1 };
+  unsigned duct_depth{ 2 };     // Levels in the supply duct tree, zero for no ducts
+  unsigned duct_branching{ 2 }; // Branches at each level of the duct tree
+  unsigned cracks_per_zone{ 1 }; // Facade cracks from each zone to the outside
+  double story_height{ 3.0 };
+  double wind_pressure{ 10.0 }; // Dynamic pressure of the wind [Pa]
+  double fan_pressure{ 50.0 };  // Supply fan pressure rise [Pa]
+  double indoor_temperature{ 20.0 };
+  double outdoor_temperature{ 0.0 };
+  Ordering ordering{ Ordering::Natural };
+  unsigned seed{ 0 };
+};
+
+// Description of a network that can be written out as XML or used to build a model directly
+struct Network
+{
+  struct Element
+  {
+    std::string name;
+    double coefficient;
+    double exponent;
+  };
+
+  struct Node
+  {
+    std::string name;
+    NodeType type;
+    double height;
+    double pressure;
+    double temperature;
+  };
+
+  struct Link
+  {
+    std::string name;
+    size_t node0;
+    size_t node1;
+    size_t element;
+  };
+
+  // Values are written with enough digits to read back exactly, so the XML describes the same model as build()
+  void write_xml(std::ostream& stream) const
+  {
+    auto precision = stream.precision(std::numeric_limits<double>::max_digits10);
+    stream << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<AirflowNetwork>\n  <Elements>\n";
+    for (auto& element : elements) {
+      stream << "    <PowerLaw ID=\"" << element.name << "\"><Coefficient>" << element.coefficient << "</Coefficient><Exponent>"
+        << element.exponent << "</Exponent></PowerLaw>\n";
+    }
+    stream << "  </Elements>\n  <Nodes>\n";
+    for (auto& node : nodes) {
+      stream << "    <Node ID=\"" << node.name << "\">";
+      if (node.type == NodeType::Fixed) {
+        stream << "<PressureHandling>Fixed</PressureHandling>";
+      }
+      stream << "<RelativeHeight>" << node.height << "</RelativeHeight><DefaultState><Temperature units=\"C\">" << node.temperature
+        << "</Temperature><Pressure units=\"Pa\">" << node.pressure << "</Pressure></DefaultState></Node>\n";
+    }
+    stream << "  </Nodes>\n  <Links>\n";
+    for (auto& link : links) {
+      stream << "    <Link ID=\"" << link.name << "\"><ElementID IDref=\"" << elements[link.element].name << "\"/><Nodes><Node><NodeID IDref=\""
+        << nodes[link.node0].name << "\"/></Node><Node><NodeID IDref=\"" << nodes[link.node1].name << "\"/></Node></Nodes></Link>\n";
+    }
+    stream << "  </Links>\n</AirflowNetwork>\n";
+    stream.precision(precision);
+  }
+
+  // Add everything to a model with the incremental construction functions and set it up
+  template <typename M> bool build(M& model) const
+  {
+    typedef typename decltype(model.find_node(""))::value_type I;
+    std::vector<I> element_handles;
+    for (auto& element : elements) {
+      auto handle = model.add_powerlaw(element.name, element.coefficient, element.coefficient, element.exponent);
+      if (!handle) {
+        return false;
+      }
+      element_handles.push_back(handle.value());
+    }
+    std::vector<I> node_handles;
+    for (auto& node : nodes) {
+      auto handle = model.add_node(node.name, node.type, node.height, node.pressure, node.temperature);
+      if (!handle) {
+        return false;
+      }
+      node_handles.push_back(handle.value());
+    }
+    for (auto& link : links) {
+      if (!model.add_link(link.name, node_handles[link.node0], node_handles[link.node1], element_handles[link.element])) {
+        return false;
+      }
+    }
+    return model.setup();
+  }
+
+  std::vector<Element> elements;
+  std::vector<Node> nodes;
+  std::vector<Link> links;
+};
+
+inline Network generate(const Building& building)
+{
+  Network network;
+  const double p0{ 101325.0 };
+  enum : size_t { crack, door, stair, duct };
+  network.elements = { { "Crack", 1.0e-5, 0.65 }, { "Door", 1.0e-4, 0.65 }, { "Stair", 5.0e-4, 0.65 }, { "Duct", 1.0e-4, 0.65 } };
+
+  // Build up the list of nodes in the natural order, zone by zone and story by story
+  std::vector<Network::Node> nodes;
+  auto add = [&nodes](const std::string& name, NodeType type, double height, double pressure, double temperature) {
+    nodes.push_back({ name, type, height, pressure, temperature });
+    return nodes.size() - 1;
+  };
+  // Pressure coefficients for the four sides of the building
+  const double cp[4]{ 0.6, -0.3, -0.5, -0.3 };
+  std::vector<std::vector<size_t>> zones(building.stories);
+  std::vector<std::vector<size_t>> ambient(building.stories);
+  std::vector<std::vector<size_t>> stairs(building.stairwells);
+  std::vector<std::vector<size_t>> shafts(building.shafts);
+  for (unsigned story = 0; story < building.stories; ++story) {
+    double z{ story * building.story_height };
+    std::string suffix{ std::to_string(story) };
+    for (unsigned i = 0; i < building.zones_per_story; ++i) {
+      zones[story].push_back(add("Zone" + suffix + "_" + std::to_string(i), NodeType::Simulated, z, p0, building.indoor_temperature));
+    }
+    for (unsigned s = 0; s < building.stairwells; ++s) {
+      stairs[s].push_back(add("Stair" + std::to_string(s) + "_" + suffix, NodeType::Simulated, z, p0, building.indoor_temperature));
+    }
+    for (unsigned s = 0; s < building.shafts; ++s) {
+      shafts[s].push_back(add("Shaft" + std::to_string(s) + "_" + suffix, NodeType::Simulated, z, p0, building.indoor_temperature));
+    }
+    for (unsigned side = 0; side < 4; ++side) {
+      ambient[story].push_back(add("Ambient" + suffix + "_" + std::to_string(side), NodeType::Fixed, z,
+        p0 + cp[side] * building.wind_pressure, building.outdoor_temperature));
+    }
+  }
+  // Supply duct tree, fed from the fan
+  std::vector<size_t> leaves;
+  std::vector<std::pair<size_t, size_t>> duct_links;
+  if (building.duct_depth > 0 && building.stories > 0) {
+    size_t fan = add("Fan", NodeType::Fixed, 0.0, p0 + building.fan_pressure, building.indoor_temperature);
+    std::vector<size_t> level{ fan };
+    size_t count{ 0 };
+    for (unsigned depth = 0; depth < building.duct_depth; ++depth) {
+      std::vector<size_t> next;
+      for (auto parent : level) {
+        unsigned branches = depth == 0 ? 1 : building.duct_branching;
+        for (unsigned b = 0; b < branches; ++b) {
+          size_t child = add("Duct" + std::to_string(count++), NodeType::Simulated, 0.0, p0, building.indoor_temperature);
+          duct_links.emplace_back(parent, child);
+          next.push_back(child);
+        }
+      }
+      level = next;
+    }
+    leaves = level;
+  }
+
+  // Reorder the nodes as requested, the links refer to the original positions through this map
+  std::vector<size_t> order(nodes.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (building.ordering == Ordering::Reversed) {
+    std::reverse(order.begin(), order.end());
+  } else if (building.ordering == Ordering::Random) {
+    std::mt19937 rng(building.seed);
+    std::shuffle(order.begin(), order.end(), rng);
+  }
+  std::vector<size_t> position(nodes.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    network.nodes.push_back(nodes[order[i]]);
+    position[order[i]] = i;
+  }
+  auto link = [&network, &position](const std::string& name, size_t node0, size_t node1, size_t element) {
+    network.links.push_back({ name, position[node0], position[node1], element });
+  };
+
+  for (unsigned story = 0; story < building.stories; ++story) {
+    std::string suffix{ std::to_string(story) };
+    auto& zone = zones[story];
+    for (size_t i = 0; i < zone.size(); ++i) {
+      std::string name{ std::to_string(story) + "_" + std::to_string(i) };
+      if (i + 1 < zone.size()) {
+        link("Door" + name, zone[i], zone[i + 1], door);
+      }
+      for (unsigned c = 0; c < building.cracks_per_zone; ++c) {
+        link("Crack" + name + "_" + std::to_string(c), zone[i], ambient[story][(i + c) % 4], crack);
+      }
+    }
+    if (zone.empty()) {
+      continue;
+    }
+    for (unsigned s = 0; s < building.stairwells; ++s) {
+      std::string name{ std::to_string(s) + "_" + suffix };
+      link("StairDoor" + name, stairs[s][story], zone[s % zone.size()], door);
+      if (story > 0) {
+        link("Stair" + name, stairs[s][story - 1], stairs[s][story], stair);
+      }
+    }
+    for (unsigned s = 0; s < building.shafts; ++s) {
+      std::string name{ std::to_string(s) + "_" + suffix };
+      link("ShaftDoor" + name, shafts[s][story], zone[(zone.size() - 1 - s % zone.size())], crack);
+      if (story > 0) {
+        link("Shaft" + name, shafts[s][story - 1], shafts[s][story], stair);
+      }
+    }
+  }
+  for (size_t i = 0; i < duct_links.size(); ++i) {
+    link("Duct" + std::to_string(i), duct_links[i].first, duct_links[i].second, duct);
+  }
+  // Each leaf of the duct tree supplies some zones, spread across the stories
+  std::vector<size_t> all_zones;
+  for (auto& zone : zones) {
+    all_zones.insert(all_zones.end(), zone.begin(), zone.end());
+  }
+  if (!leaves.empty()) {
+    for (size_t i = 0; i < all_zones.size(); ++i) {
+      link("Supply" + std::to_string(i), leaves[i % leaves.size()], all_zones[i], duct);
+    }
+  }
+  return network;
+}
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_GENERATOR_HPP
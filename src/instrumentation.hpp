@@ -0,0 +1,169 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_INSTRUMENTATION_HPP
+#define AIRFLOWNETWORK_INSTRUMENTATION_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#ifdef AIRFLOWNETWORK_INSTRUMENTATION
+#include <chrono>
+#endif
+
+namespace airflownetwork {
+namespace instrumentation {
+
+// Timing and counts are only collected when AIRFLOWNETWORK_INSTRUMENTATION is defined, otherwise the
+// scopes are empty and the statistics stay at zero
+#ifdef AIRFLOWNETWORK_INSTRUMENTATION
+constexpr bool enabled{ true };
+#else
+constexpr bool enabled{ false };
+#endif
+
+// The airflow solve factors and back-substitutes in one call, so Factorization covers both. Transport
+// steps are kept apart from the airflow phases, with Transport the total for the steps and the other
+// two transport phases the parts of it spent in the linear solver.
+enum class Phase : unsigned { Load, Setup, Stack, Filjac, Factorization, Output, Transport, TransportFactorization, TransportSolve };
+constexpr size_t phase_count{ 9 };
+
+inline const char* name(Phase phase)
+{
+  static const char* names[phase_count]{ "load", "setup", "stack", "filjac", "factorization", "output", "transport",
+    "transport_factorization", "transport_solve" };
+  return names[static_cast<unsigned>(phase)];
+}
+
+enum class ElementType : unsigned { PowerLaw, ContamXPowerLaw, Other };
+constexpr size_t element_type_count{ 3 };
+
+inline const char* name(ElementType type)
+{
+  static const char* names[element_type_count]{ "PowerLaw", "ContamXPowerLaw", "Other" };
+  return names[static_cast<unsigned>(type)];
+}
+
+struct Counter
+{
+  double seconds{ 0.0 };
+  std::uint64_t count{ 0 };
+};
+
+struct Statistics
+{
+  Counter& operator[](Phase phase)
+  {
+    return phases[static_cast<unsigned>(phase)];
+  }
+
+  const Counter& operator[](Phase phase) const
+  {
+    return phases[static_cast<unsigned>(phase)];
+  }
+
+  std::uint64_t& operator[](ElementType type)
+  {
+    return evaluations[static_cast<unsigned>(type)];
+  }
+
+  std::uint64_t operator[](ElementType type) const
+  {
+    return evaluations[static_cast<unsigned>(type)];
+  }
+
+  // Add a batch of element evaluations, one count per element type
+  void evaluate(const std::array<std::uint64_t, element_type_count>& counts)
+  {
+    if constexpr (enabled) {
+      for (size_t i = 0; i < element_type_count; ++i) {
+        evaluations[i] += counts[i];
+      }
+    }
+  }
+
+  void reset()
+  {
+    phases.fill(Counter());
+    evaluations.fill(0);
+  }
+
+  void write_json(std::ostream& stream) const
+  {
+    stream << "{\n  \"enabled\": " << (enabled ? "true" : "false") << ",\n  \"phases\": {";
+    for (size_t i = 0; i < phase_count; ++i) {
+      stream << (i == 0 ? "\n" : ",\n") << "    \"" << name(static_cast<Phase>(i)) << "\": { \"seconds\": " << phases[i].seconds
+        << ", \"count\": " << phases[i].count << " }";
+    }
+    stream << "\n  },\n  \"element_evaluations\": {";
+    for (size_t i = 0; i < element_type_count; ++i) {
+      stream << (i == 0 ? "\n" : ",\n") << "    \"" << name(static_cast<ElementType>(i)) << "\": " << evaluations[i];
+    }
+    stream << "\n  }\n}\n";
+  }
+
+  std::array<Counter, phase_count> phases;
+  std::array<std::uint64_t, element_type_count> evaluations{};
+};
+
+// Adds the time between construction and destruction to a phase, a null statistics pointer is allowed
+#ifdef AIRFLOWNETWORK_INSTRUMENTATION
+class Scope
+{
+public:
+  Scope(Statistics* statistics, Phase phase) : m_counter(statistics ? &(*statistics)[phase] : nullptr),
+    m_start(std::chrono::steady_clock::now())
+  {}
+
+  ~Scope()
+  {
+    if (m_counter) {
+      m_counter->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+      ++m_counter->count;
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  Counter* m_counter;
+  std::chrono::steady_clock::time_point m_start;
+};
+#else
+class Scope
+{
+public:
+  Scope(Statistics*, Phase)
+  {}
+};
+#endif
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_INSTRUMENTATION_HPP
@@ -29,6 +29,7 @@
 #define AIRFLOWNETWORK_LINK_HPP
 
 #include <string>
+#include <vector>
 #include <functional>
 #include "element.hpp"
 #include "node.hpp"
@@ -38,24 +39,27 @@ namespace airflownetwork {
 
 struct AirProperties;
 
+// Stack pressure difference across a link, using the upwind density when there is flow
+inline double stack_pressure(double flow, double density0, double density1, double dz, double height0, double height1)
+{
+  if (flow > 0.0) {
+    return 9.80 * (density0 * dz + height1 * (density0 - density1));
+  } else if (flow < 0.0) {
+    return 9.80 * (density1 * dz + height0 * (density1 - density0));
+  }
+  return 4.90 * ((density0 + density1) * dz + (height0 + height1) * (density1 - density0));
+}
+
 template <typename I, typename P> struct Link
 {
-  Link(const std::string &name, Node<I,P> &node0, Node<I,P> &node1, Element<P> &element, double height0=0.0,
+  Link(Name name, Node<I,P> &node0, Node<I,P> &node1, Element<P> &element, double height0=0.0,
     double height1=0.0, double flow0=0.0, double flow1=0.0, double multiplier=1.0) : name(name), node0(node0), node1(node1),
-    element(element), height0(height0), height1(height1), stack_delta_p(0.0), added_delta_p(0.0), delta_p(0.0), flow(flow0-flow1), flow0(flow0), flow1(flow1), multiplier(multiplier), control(1.0), index0(0), index1(0)
+    element(element), height0(height0), height1(height1), stack_delta_p(0.0), added_delta_p(0.0), delta_p(0.0), flow(flow0-flow1), flow0(flow0), flow1(flow1), multiplier(multiplier), control(1.0), nf(1), index0(0), index1(0)
   {}
 
   double upwind_stack_pressure() // This is maybe not a great name
   {
-    double ps;
-    if (flow > 0.0) {
-      ps = 9.80 * (node0.density * (node0.height - node1.height) + height1 * (node0.density - node1.density));
-    } else if (flow < 0.0) {
-      ps = 9.80 * (node1.density * (node0.height - node1.height) + height0 * (node1.density - node0.density));
-    } else {
-      ps = 4.90 * ((node0.density + node1.density) * (node0.height - node1.height) + (height0 + height1) * (node1.density - node0.density));
-    }
-    return ps;
+    return stack_pressure(flow, node0.density, node1.density, node0.height - node1.height, height0, height1);
   }
 
   void set_flow(double f)
@@ -64,7 +68,7 @@ template <typename I, typename P> struct Link
     flow1 = 0.0;
   }
 
-  const std::string name;
+  const Name name;
   const Node<I, P>& node0;
   const Node<I, P>& node1;
   const Element<P>& element;
@@ -90,6 +94,66 @@ template <typename I, typename P> struct Link
   I index1;
 };
 
+// A mirror of the per-link data that the flow solver touches on every iteration, stored as parallel
+// arrays so that the Newton iterations stream through only what they use. This is a copy, not a split:
+// the Link objects remain the record of the model state. The inputs are copied in at the start of each
+// solve and the results copied back out at the end, so changes made to the links between solves are
+// always picked up and the arrays are only read directly for the results of the last solve. The two
+// copies cost about a tenth of one Jacobian fill per solve (model/gather_links, model/scatter_links and
+// model/filjac in the benchmarks), which is why the links were not slimmed down to cold data.
+template <typename I, typename P> struct LinkArrays
+{
+  size_t size() const
+  {
+    return node0.size();
+  }
+
+  void clear()
+  {
+    resize(0);
+  }
+
+  size_t memory_usage() const
+  {
+    return (node0.capacity() + node1.capacity() + offset.capacity()) * sizeof(I) + element.capacity() * sizeof(const Element<P>*)
+      + (dz.capacity() + height0.capacity() + height1.capacity() + multiplier.capacity() + control.capacity()
+        + stack_delta_p.capacity() + added_delta_p.capacity() + delta_p.capacity() + flow.capacity()) * sizeof(double);
+  }
+
+  void resize(size_t n)
+  {
+    node0.resize(n);
+    node1.resize(n);
+    offset.resize(n);
+    element.resize(n);
+    dz.resize(n);
+    height0.resize(n);
+    height1.resize(n);
+    multiplier.resize(n);
+    control.resize(n);
+    stack_delta_p.resize(n);
+    added_delta_p.resize(n);
+    delta_p.resize(n);
+    flow.resize(n);
+  }
+
+  std::vector<I> node0;  // Solver index of node 0
+  std::vector<I> node1;  // Solver index of node 1
+  std::vector<I> offset; // Location of the off-diagonal Jacobian term, only set if both nodes are simulated
+  std::vector<const Element<P>*> element;
+
+  std::vector<double> dz; // Node 0 height minus node 1 height
+  std::vector<double> height0;
+  std::vector<double> height1;
+
+  std::vector<double> multiplier;
+  std::vector<double> control;
+  std::vector<double> stack_delta_p;
+  std::vector<double> added_delta_p;
+  std::vector<double> delta_p;
+  std::vector<double> flow;
+};
+
 }
 
 #endif // !AIRFLOWNETWORK_LINK_HPP
@@ -30,15 +30,16 @@
 
 #include <string>
 #include "properties.hpp"
+#include "names.hpp"
 
 namespace airflownetwork {
 
 struct Material
 {
-  Material(const std::string &name, double default_concentration=0.0) : name(name), default_concentration(default_concentration)
+  Material(Name name, double default_concentration=0.0) : name(name), default_concentration(default_concentration)
   {}
 
-  const std::string name;
+  const Name name;
   const double default_concentration;
 };
 
@@ -0,0 +1,89 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_MEMORY_HPP
+#define AIRFLOWNETWORK_MEMORY_HPP
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <ostream>
+#include <iomanip>
+
+namespace airflownetwork {
+namespace memory {
+
+template <typename T, typename A> size_t bytes(const std::vector<T, A>& vector)
+{
+  return vector.capacity() * sizeof(T);
+}
+
+// Estimate for a node-based hash map, each entry also holds a next pointer and a cached hash
+template <typename K, typename V> size_t bytes(const std::unordered_map<K, V>& map)
+{
+  return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void*));
+}
+
+inline size_t bytes(const std::string& string)
+{
+  return string.capacity() > std::string().capacity() ? string.capacity() + 1 : 0;
+}
+
+// Breakdown of the memory held by a model, in bytes. A model does not own its transport steppers,
+// patterns or pass-through factors, so a caller that has them adds their memory_usage() to transport.
+struct Usage
+{
+  size_t total() const
+  {
+    return nodes + links + elements + names + lookups + skyline + solver + transport + output;
+  }
+
+  void write(std::ostream& stream) const
+  {
+    const std::pair<const char*, size_t> rows[]{ { "Nodes", nodes }, { "Links", links }, { "Elements", elements }, { "Names", names },
+      { "Lookups", lookups }, { "Skyline", skyline }, { "Solver", solver }, { "Transport", transport }, { "Output", output },
+      { "Total", total() } };
+    for (auto& row : rows) {
+      stream << std::left << std::setw(12) << row.first << std::right << std::setw(14) << row.second << " bytes\n";
+    }
+  }
+
+  size_t nodes{ 0 };
+  size_t links{ 0 };
+  size_t elements{ 0 }; // Elements and materials
+  size_t names{ 0 }; // Name storage
+  size_t lookups{ 0 }; // Name to handle maps
+  size_t skyline{ 0 }; // Jacobian storage
+  size_t solver{ 0 }; // Solution vectors, link arrays, and convergence history
+  size_t transport{ 0 }; // Concentrations and filters, plus whatever the caller adds for its transport objects
+  size_t output{ 0 };
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_MEMORY_HPP
@@ -30,19 +30,41 @@
 
 #include <string>
 #include <unordered_map>
+#include <optional>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <fstream>
+#include <iostream>
 #include <memory>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstdint>
+#include "arena.hpp"
+#include "names.hpp"
 #include "node.hpp"
 #include "material.hpp"
 #include "link.hpp"
 #include "powerlaw.hpp"
+#include "output.hpp"
+#include "checkpoint.hpp"
+#include "instrumentation.hpp"
+#include "trace.hpp"
+#include "convergence.hpp"
+#include "memory.hpp"
 #include "pugixml.hpp"
 #include "skyline.hpp"
 
 namespace airflownetwork {
 
+// Index type for the executables, 32-bit indices halve the size of the index arrays on large networks
+#ifdef AIRFLOWNETWORK_32BIT_INDEX
+typedef std::uint32_t Index;
+#else
+typedef size_t Index;
+#endif
+
 template <typename I, typename P> struct Model
 {
   Model(const std::string &name) : name(name), tolerance(1.0e-4)
@@ -53,22 +75,29 @@ template <typename I, typename P> struct Model
   bool load(const pugi::xml_node &root)
   {
     bool success{ true };
-    // Get the data from the XML
-    auto materials = root.child("Materials");
-    if (materials) {
-      success &= load_materials(materials);
-    }
-    auto elements = root.child("Elements");
-    if (elements) {
-      success &= load_elements(elements);
-    }
-    auto nodes = root.child("Nodes");
-    if (nodes) {
-      success &= load_nodes(nodes);
-    }
-    auto link_list = root.child("Links");
-    if (link_list) {
-      success &= load_links(link_list);
+    {
+      instrumentation::Scope scope(&statistics, instrumentation::Phase::Load);
+      // Get the data from the XML
+      auto materials = root.child("Materials");
+      if (materials) {
+        success &= load_materials(materials);
+      }
+      auto elements = root.child("Elements");
+      if (elements) {
+        success &= load_elements(elements);
+      }
+      auto nodes = root.child("Nodes");
+      if (nodes) {
+        success &= load_nodes(nodes);
+      }
+      auto link_list = root.child("Links");
+      if (link_list) {
+        success &= load_links(link_list);
+      }
+      auto outputs = root.child("Outputs");
+      if (outputs) {
+        success &= load_outputs(outputs);
+      }
     }
     if (success) {
       success &= setup();
@@ -107,10 +136,12 @@ template <typename I, typename P> struct Model
       }*/
     }
 
-    for (auto& el : p) {
-      std::cout << el << std::endl;
+    if (verbose) {
+      for (auto& el : p) {
+        std::cout << el << std::endl;
+      }
+      std::cout << std::endl;
     }
-    std::cout << std::endl;
 
     /*
     for (auto& el : skyline->diagonal()) {
@@ -120,10 +151,15 @@ template <typename I, typename P> struct Model
     */
 
     // Solve
-    skyline->ldlt_solve(p);
+    {
+      instrumentation::Scope scope(&statistics, instrumentation::Phase::Factorization);
+      skyline->ldlt_solve(p);
+    }
 
-    for (auto& el : p) {
-      std::cout << el << std::endl;
+    if (verbose) {
+      for (auto& el : p) {
+        std::cout << el << std::endl;
+      }
     }
 
     // Copy the pressures into the nodes
@@ -138,181 +174,276 @@ template <typename I, typename P> struct Model
       link.element.calculate(false, dp, link.multiplier, 1.0, link.node0, link.node1, F, DF);
       link.flow = link.flow0 = F[0];
     }
+    ++flow_version;
   }
 
+  // Uses the flow directions of the most recent solve, call gather_links() first if the links were modified
   void calculate_stack_pressures()
   {
-    for (auto& link : links) {
-      link.stack_delta_p = link.upwind_stack_pressure();
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Stack);
+    for (size_t k = 0; k < m_hot.size(); ++k) {
+      const Node<I,P>& node0{ *m_ordered[m_hot.node0[k]] };
+      const Node<I,P>& node1{ *m_ordered[m_hot.node1[k]] };
+      m_hot.stack_delta_p[k] = stack_pressure(m_hot.flow[k], node0.density, node1.density, m_hot.dz[k], m_hot.height0[k],
+        m_hot.height1[k]);
     }
   }
 
-  void steady_solve()
+  // Once setup() has been called, solving does not allocate memory unless verbose output is on
+  bool steady_solve()
   {
+    trace::Span span(tracer, "steady_solve", "airflow");
+    gather_links();
     calculate_stack_pressures();
 
     double alpha = 1.0;
 
     double delta_max = 1.0e6;
-    int iter_max{ 25 };
-    int iter{ 1 };
+    int iter{ 0 };
     double sum_max{ 0.0 };
-    // Will always do at least one iteration, so split out the first iteration
-    for (auto& link : links) {
-      link.delta_p = link.node0.pressure - link.node1.pressure + link.stack_delta_p + link.added_delta_p;
+    size_t n{ simulated_nodes.size() };
+    history.reset(links.size());
+    for (size_t k = 0; k < m_hot.size(); ++k) {
+      m_flow_sign[k] = sign(m_hot.flow[k]);
     }
-    // Fill the Jacobian matrix
-    filjac();
-    // Solve the system
-    skyline->ldlt_solve(sum);
-    // Update the pressures in the nodes
-    for (auto& node : simulated_nodes) {
-      node.pressure -= alpha * sum[node.index];
-    }
-    // At this point, the pressures are updated for one iteration, but the flows are not
 
     do {
+      trace::Span iteration(tracer, "newton", "airflow");
+      iteration.arg("iteration", iter);
       // Compute the pressure differences across the links
-      for (auto& link : links) {
-        link.delta_p = link.node0.pressure - link.node1.pressure + link.stack_delta_p + link.added_delta_p;
-      }
+      calculate_pressure_differences();
 
       // Fill the Jacobian matrix, which updates the flows as well
       filjac();
 
       // Check for convergence here
-      for (size_t i = 0; i < simulated_nodes.size(); ++i) {
-        sum_max = std::max(sum_max, std::abs(sum[i]));
-      }
+      sum_max = record_iteration(iter);
 
-      std::cout << iter << ' ' << sum_max << std::endl;
+      if (verbose) {
+        std::cout << iter << ' ' << sum_max << std::endl;
+      }
+      iteration.arg("residual", sum_max);
 
+      // A re-solve of an unchanged network stops in the first iteration, before the pressures are touched,
+      // so that the flows come out exactly as before
       if (sum_max < tolerance) {
-        //break;
-        return; // Need to return convergence information
+        span.arg("iterations", iter);
+        span.arg("residual", sum_max);
+        span.arg("converged", 1);
+        history.converged = true;
+        scatter_links();
+        return true;
       }
 
       // Solve the system
-      skyline->ldlt_solve(sum);
+      solve();
       ++iter;
-      // Update the pressures in the nodes
-      for (auto& node : simulated_nodes) {
-        node.pressure -= alpha * sum[node.index];
-      }
 
-      // Update
+      // Update the pressures, the simulated nodes are the first n entries
       delta_max = 0.0;
-      for (size_t i = 0; i < simulated_nodes.size(); ++i) {
+      for (size_t i = 0; i < n; ++i) {
         delta_max = std::max(delta_max, std::abs(sum[i]));
         p[i] -= alpha*sum[i];
       }
-     
-      // Copy the pressures into the nodes
-      for (auto& node : simulated_nodes) {
-        node.pressure = p[node.index];
-      }
+      iteration.arg("correction", delta_max);
+      history.iterations.back().correction_max = delta_max;
 
-    } while (iter < iter_max); // delta_max > tolerance);
+    } while (iter < max_iterations); // delta_max > tolerance);
 
     // Only get to here if there's a convergence failure
-    std::cout << "Convergence Failure" << std::endl;
-    
+    span.arg("iterations", iter);
+    span.arg("residual", sum_max);
+    span.arg("converged", 0);
+    scatter_links();
+    if (verbose) {
+      std::cout << "Convergence Failure" << std::endl;
+    }
+    return false;
   }
 
-  bool validate_network()
+  // Refresh the solver's mirror of the links from the Link objects, which are the authoritative copy
+  void gather_links()
   {
+    size_t k{ 0 };
     for (auto& link : links) {
-      if (!(link.node0.variable || link.node1.variable)) {
-        errors.push_back("Link \"" + link.name + "\" connects two non-simulated nodes");
-        return false;
-      }
+      m_hot.multiplier[k] = link.multiplier;
+      m_hot.control[k] = link.control;
+      m_hot.added_delta_p[k] = link.added_delta_p;
+      m_hot.flow[k] = link.flow;
+      ++k;
+    }
+    for (size_t i = 0; i < m_ordered.size(); ++i) {
+      p[i] = m_ordered[i]->pressure;
     }
-    return true;
   }
 
-  bool save(const std::string& filename) const
+  // Copy the solver results back out to the links and nodes, the flow version only changes if a flow did
+  void scatter_links()
   {
-    pugi::xml_document doc;
-    auto root = doc.append_child("AirflowNetwork");
-    root.append_attribute("xmlns") = "http://github.com/jasondegraw/AirflowNetwork";
-    root.append_attribute("xmlns:xsi") = "http://www.w3.org/2001/XMLSchema-instance";
-    //root.append_attribute("xmlns:xsd") = "http://www.w3.org/2001/XMLSchema";
-    root.append_attribute("xsi:schemaLocation") = "http://github.com/jasondegraw/AirflowNetwork airflownetwork.xsd";
-
-    auto xml_links = root.append_child("Links");
+    bool changed{ false };
+    size_t k{ 0 };
     for (auto& link : links) {
-      auto el = xml_links.append_child("Link");
-      el.append_attribute("ID") = link.name.c_str();
+      link.stack_delta_p = m_hot.stack_delta_p[k];
+      link.delta_p = m_hot.delta_p[k];
+      changed |= link.flow != m_hot.flow[k];
+      link.flow = link.flow0 = m_hot.flow[k];
+      ++k;
     }
-
-    auto xml_flow_results = root.append_child("FlowResults");
-    auto xml_flow_result = xml_flow_results.append_child("FlowResult");
-    for (auto& link : links) {
+    for (auto& node : simulated_nodes) {
+      node.pressure = p[node.index];
     }
-
-    std::ofstream file(filename);
-    if (file.is_open()) {
-      doc.save(file, "  ");
-      file.close();
-      return true;
+    if (changed) {
+      ++flow_version;
     }
-    return false;
   }
 
-  bool open_output(const std::string& basepath)
+  std::optional<I> find_node(std::string_view name) const
   {
-    m_pressure_output = std::make_unique<std::ofstream>(basepath + "_p.csv");
-    m_flow_output = std::make_unique<std::ofstream>(basepath + "_f.csv");
-    if(!(m_pressure_output->is_open() && m_flow_output->is_open())) {
-      return false;
+    return find(node_lookup, name);
+  }
+
+  std::optional<I> find_link(std::string_view name) const
+  {
+    return find(link_lookup, name);
+  }
+
+  std::optional<I> find_element(std::string_view name) const
+  {
+    return find(element_lookup, name);
+  }
+
+  std::optional<I> find_material(std::string_view name) const
+  {
+    return find(material_lookup, name);
+  }
+
+  // Node handles are assigned in the order the nodes are added and do not change as the model grows,
+  // unlike the solver index, which puts the simulated nodes first
+  Node<I,P>& node(I handle)
+  {
+    return *m_nodes[handle];
+  }
+
+  const Node<I,P>& node(I handle) const
+  {
+    return *m_nodes[handle];
+  }
+
+  size_t node_count() const
+  {
+    return m_nodes.size();
+  }
+
+  // Change the iteration limit, only the convergence history is resized so the solver arrays stay put
+  void set_max_iterations(int count)
+  {
+    max_iterations = count;
+    history.iterations.reserve(count);
+  }
+
+  // The solver's copy of the link flows, in link order and only valid after setup()
+  const std::vector<double>& link_flows() const
+  {
+    return m_hot.flow;
+  }
+
+  // Incremental model construction. The storage is stable, so objects can be added after a model
+  // has been loaded, but setup() must be called again before solving.
+  std::optional<I> add_node(const std::string& name, NodeType type, double height = 0.0, double pressure = P::pressure_0,
+    double temperature = P::temperature_0, double humidity_ratio = P::humidity_ratio_0)
+  {
+    if (m_nodes.size() >= std::numeric_limits<I>::max()) {
+      errors.push_back("Node \"" + name + "\" exceeds the number of nodes supported by the index type");
+      return {};
     }
-    *m_pressure_output << "Time(s)";
-    for (auto& node : simulated_nodes) {
-      *m_pressure_output << ',' << node.name;
+    Name id{ names.intern(name) };
+    if (node_lookup.find(id) != node_lookup.end()) {
+      errors.push_back("Node \"" + name + "\" is defined more than once");
+      return {};
     }
-    *m_pressure_output << std::endl;
-
-    *m_flow_output << "Time(s)";
-    for (auto& link : links) {
-      *m_flow_output << ',' << link.name;
+    Node<I,P>* node{ nullptr };
+    switch (type) {
+    case NodeType::Simulated:
+      node = &simulated_nodes.emplace_back(id, height, pressure, temperature, humidity_ratio);
+      node->variable = true;
+      break;
+    case NodeType::Fixed:
+      node = &fixed_nodes.emplace_back(id, height, pressure, temperature, humidity_ratio);
+      break;
+    case NodeType::Calculated:
+      node = &calculated_nodes.emplace_back(id, height, pressure, temperature, humidity_ratio);
+      break;
     }
-    *m_flow_output << std::endl;
-    return true;
+    I handle{ static_cast<I>(m_nodes.size()) };
+    m_nodes.push_back(node);
+    node_lookup.emplace(id, handle);
+    m_renumber = true;
+    return handle;
   }
 
-  bool write_output(double seconds)
+  std::optional<I> add_powerlaw(const std::string& name, double coefficient, double laminar_coefficient, double exponent = 0.65,
+    double referenceP = 101325.0, double referenceT = 20.0, double referenceW = 0.0)
   {
-    *m_pressure_output << seconds;
-    for (auto& node : simulated_nodes) {
-      *m_pressure_output << ',' << node.pressure;
+    Name id{ names.intern(name) };
+    if (element_lookup.find(id) != element_lookup.end()) {
+      errors.push_back("Element \"" + name + "\" is defined more than once");
+      return {};
     }
-    *m_pressure_output << std::endl;
+    return add_element(powerlaw_elements.emplace_back(id, coefficient, laminar_coefficient, exponent, referenceP, referenceT, referenceW));
+  }
 
-    *m_flow_output << seconds;
-    for (auto& link : links) {
-      *m_flow_output << ',' << link.flow;
+  std::optional<I> add_contamx_powerlaw(const std::string& name, double coefficient, double laminar_coefficient, double exponent = 0.65)
+  {
+    Name id{ names.intern(name) };
+    if (element_lookup.find(id) != element_lookup.end()) {
+      errors.push_back("Element \"" + name + "\" is defined more than once");
+      return {};
     }
-    *m_flow_output << std::endl;
-    return true;
+    return add_element(contamx_powerlaw_elements.emplace_back(id, coefficient, laminar_coefficient, exponent));
   }
 
-  bool close_output()
+  std::optional<I> add_link(const std::string& name, I node0, I node1, I element, double height0 = 0.0, double height1 = 0.0,
+    double multiplier = 1.0)
   {
-    m_pressure_output->close();
-    m_pressure_output.reset();
-    m_flow_output->close();
-    m_flow_output.reset();
-    return true;
+    if (links.size() >= std::numeric_limits<I>::max()) {
+      errors.push_back("Link \"" + name + "\" exceeds the number of links supported by the index type");
+      return {};
+    }
+    Name id{ names.intern(name) };
+    if (link_lookup.find(id) != link_lookup.end()) {
+      errors.push_back("Link \"" + name + "\" is defined more than once");
+      return {};
+    }
+    if (node0 >= m_nodes.size() || node1 >= m_nodes.size() || element >= elements.size()) {
+      errors.push_back("Link \"" + name + "\" refers to a nonexistent node or element");
+      return {};
+    }
+    if (m_renumber) {
+      renumber();
+    }
+    auto& node0_ref{ *m_nodes[node0] };
+    auto& node1_ref{ *m_nodes[node1] };
+    auto& element_ref{ *elements[element] };
+#ifdef UNORDERED_NODES
+    links.emplace_back(id, node0_ref, node1_ref, element_ref, height0, height1, 0.0, 0.0, multiplier);
+#else
+    if (node0_ref.index < node1_ref.index) {
+      links.emplace_back(id, node0_ref, node1_ref, element_ref, height0, height1, 0.0, 0.0, multiplier);
+    } else {
+      links.emplace_back(id, node1_ref, node0_ref, element_ref, height1, height0, 0.0, 0.0, multiplier);
+    }
+#endif
+    I handle{ static_cast<I>(links.size() - 1) };
+    link_lookup.emplace(id, handle);
+    return handle;
   }
 
-  //bool explicit_transport(I cxi, std::vector<double>& CN, std::vector<double>& C0)
-  //{
-  //
-  //}
-
-private:
   bool setup()
   {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Setup);
+    if (m_renumber) {
+      renumber();
+    }
     // Figure out the skyline heights
     std::vector<I> h(simulated_nodes.size(), 0);
     for (auto& el : links) {
@@ -325,13 +456,13 @@ private:
           i = el.node1.index;
           j = el.node0.index;
         } else if (i == j) {
-          errors.push_back("Link \"" + el.name + "\" connects a node to itself and is a loop");
+          errors.push_back("Link \"" + std::string(names[el.name]) + "\" connects a node to itself and is a loop");
           return false;
         }
 #else
         // In the ordered case, only need to check for the possibility of a horrifying loop 
         if (i == j) {
-          errors.push_back("Link \"" + el.name + "\" connects a node to itself and is a loop");
+          errors.push_back("Link \"" + std::string(names[el.name]) + "\" connects a node to itself and is a loop");
           return false;
         }
 #endif
@@ -339,6 +470,8 @@ private:
       }
     }
 
+    m_skyline_entries = std::accumulate(h.begin(), h.end(), size_t(0));
+
     // Get the skyline solver set up
     skyline = std::make_unique<skyline::SymmetricMatrix<I, double, std::vector>>(h);
 
@@ -355,7 +488,7 @@ private:
       if (el.node1.variable) {
         auto index = skyline->index(i, j);
         if (!index) {
-          errors.push_back("Link \"" + el.name + "\", node \"" + el.node1.name + "\" has an index outside the skyline");
+          errors.push_back("Link \"" + std::string(names[el.name]) + "\", node \"" + std::string(names[el.node1.name]) + "\" has an index outside the skyline");
           return false;
         }
         el.index1 = index.value();
@@ -363,38 +496,469 @@ private:
   }
 #endif
 
+    // Lay out the solver arrays
+    m_hot.resize(links.size());
+    size_t k{ 0 };
+    for (auto& el : links) {
+      m_hot.node0[k] = el.node0.index;
+      m_hot.node1[k] = el.node1.index;
+      m_hot.offset[k] = el.index1;
+      m_hot.element[k] = &el.element;
+      m_hot.dz[k] = el.node0.height - el.node1.height;
+      m_hot.height0[k] = el.height0;
+      m_hot.height1[k] = el.height1;
+      ++k;
+    }
+    gather_links();
+    history.iterations.reserve(max_iterations);
+    history.reset(links.size());
+    m_flow_sign.resize(links.size());
+
+    // Count up what filjac evaluates so that the counting doesn't cost anything per link
+    m_evaluations.fill(0);
+    if constexpr (instrumentation::enabled) {
+      for (auto& el : links) {
+        if (el.node0.variable) {
+          ++m_evaluations[static_cast<unsigned>(element_type(el.element))];
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool validate_network()
+  {
+    for (auto& link : links) {
+      if (!(link.node0.variable || link.node1.variable)) {
+        errors.push_back("Link \"" + std::string(names[link.name]) + "\" connects two non-simulated nodes");
+        return false;
+      }
+    }
     return true;
   }
 
+  bool save(const std::string& filename) const
+  {
+    pugi::xml_document doc;
+    auto root = doc.append_child("AirflowNetwork");
+    root.append_attribute("xmlns") = "http://github.com/jasondegraw/AirflowNetwork";
+    root.append_attribute("xmlns:xsi") = "http://www.w3.org/2001/XMLSchema-instance";
+    //root.append_attribute("xmlns:xsd") = "http://www.w3.org/2001/XMLSchema";
+    root.append_attribute("xsi:schemaLocation") = "http://github.com/jasondegraw/AirflowNetwork airflownetwork.xsd";
+
+    auto xml_links = root.append_child("Links");
+    for (auto& link : links) {
+      auto el = xml_links.append_child("Link");
+      el.append_attribute("ID") = names.c_str(link.name);
+    }
+
+    auto xml_flow_results = root.append_child("FlowResults");
+    auto xml_flow_result = xml_flow_results.append_child("FlowResult");
+    for (auto& link : links) {
+    }
+
+    std::ofstream file(filename);
+    if (file.is_open()) {
+      doc.save(file, "  ");
+      file.close();
+      return true;
+    }
+    return false;
+  }
+
+  // Opens the outputs that were loaded from the XML, or every pressure and flow under basepath if there were none
+  bool open_output(const std::string& basepath)
+  {
+    bool success{ true };
+    if (!output_specifications.empty()) {
+      for (auto& spec : output_specifications) {
+        success &= add_output(spec);
+      }
+      return success;
+    }
+    success &= add_output(output::Specification(basepath + "_p.csv", output::Variable::Pressure));
+    success &= add_output(output::Specification(basepath + "_f.csv", output::Variable::Flow));
+    return success;
+  }
+
+  bool add_output(const output::Specification& spec)
+  {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Output);
+    auto stream = std::make_unique<std::ofstream>(spec.filename);
+    if (!stream->is_open()) {
+      errors.push_back("Failed to open output file \"" + spec.filename + "\"");
+      return false;
+    }
+    output::Channel channel(std::move(stream), spec.interval, spec.statistics);
+    switch (spec.variable) {
+    case output::Variable::Pressure:
+      for (auto& node : simulated_nodes) {
+        if (output::match(spec.patterns, names[node.name])) {
+          channel.add(std::string(names[node.name]), &node.pressure);
+        }
+      }
+      break;
+    case output::Variable::Flow:
+      for (auto& link : links) {
+        if (output::match(spec.patterns, names[link.name])) {
+          channel.add(std::string(names[link.name]), &link.flow);
+        }
+      }
+      break;
+    }
+    if (channel.sources.empty()) {
+      warnings.push_back("Output \"" + spec.filename + "\" does not match any objects");
+    }
+    channel.write_header();
+    m_outputs.push_back(std::move(channel));
+    return true;
+  }
+
+  bool write_output(double seconds)
+  {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Output);
+    for (auto& channel : m_outputs) {
+      channel.record(seconds);
+    }
+    return true;
+  }
+
+  bool close_output()
+  {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Output);
+    for (auto& channel : m_outputs) {
+      channel.finish();
+    }
+    m_outputs.clear();
+    return true;
+  }
+
+  bool save_checkpoint(const std::string& filename, const Checkpoint& extra = Checkpoint())
+  {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      errors.push_back("Failed to open checkpoint file \"" + filename + "\"");
+      return false;
+    }
+    checkpoint::Writer writer(file);
+    file.write(checkpoint::magic, sizeof(checkpoint::magic));
+    writer.write(checkpoint::version);
+    writer.write(signature());
+    writer.write(extra.time);
+    writer.write(extra.cursors);
+    writer.write(static_cast<std::uint64_t>(extra.vectors.size()));
+    for (auto& vector : extra.vectors) {
+      writer.write(vector);
+    }
+    for (auto nodes : { &simulated_nodes, &fixed_nodes, &calculated_nodes }) {
+      for (auto& node : *nodes) {
+        writer.write(node.temperature);
+        writer.write(node.pressure);
+        writer.write(node.humidity_ratio);
+        writer.write(node.density);
+        writer.write(node.sqrt_density);
+        writer.write(node.viscosity);
+        writer.write(node.concentrations);
+      }
+    }
+    for (auto& link : links) {
+      writer.write(link.stack_delta_p);
+      writer.write(link.added_delta_p);
+      writer.write(link.delta_p);
+      writer.write(link.flow);
+      writer.write(link.flow0);
+      writer.write(link.flow1);
+      writer.write(link.control);
+      writer.write(link.nf);
+      for (auto& filters : link.filters) {
+        for (auto& filter : filters) {
+          writer.write(filter.control);
+        }
+      }
+    }
+    writer.write(p);
+    if (!writer.good()) {
+      errors.push_back("Failed to write checkpoint file \"" + filename + "\"");
+      return false;
+    }
+    return true;
+  }
+
+  bool load_checkpoint(const std::string& filename, Checkpoint& extra)
+  {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      errors.push_back("Failed to open checkpoint file \"" + filename + "\"");
+      return false;
+    }
+    checkpoint::Reader reader(file);
+    char magic[sizeof(checkpoint::magic)];
+    std::uint32_t version{ 0 };
+    std::uint64_t hash{ 0 };
+    file.read(magic, sizeof(magic));
+    if (!file.good() || !std::equal(magic, magic + sizeof(magic), checkpoint::magic) || !reader.read(version)
+      || version != checkpoint::version) {
+      errors.push_back("File \"" + filename + "\" is not a compatible checkpoint file");
+      return false;
+    }
+    if (!reader.read(hash) || hash != signature()) {
+      errors.push_back("Checkpoint file \"" + filename + "\" was written by a different model");
+      return false;
+    }
+    // Past this point the model is modified in place, so a read failure leaves it in an unusable state
+    bool success{ reader.read(extra.time) && reader.read(extra.cursors) };
+    std::uint64_t count{ 0 };
+    success = success && reader.read_count(count, sizeof(std::uint64_t));
+    if (success) {
+      extra.vectors.resize(count);
+      for (auto& vector : extra.vectors) {
+        success = success && reader.read(vector);
+      }
+    }
+    for (auto nodes : { &simulated_nodes, &fixed_nodes, &calculated_nodes }) {
+      for (auto& node : *nodes) {
+        success = success && reader.read(node.temperature) && reader.read(node.pressure) && reader.read(node.humidity_ratio)
+          && reader.read(node.density) && reader.read(node.sqrt_density) && reader.read(node.viscosity)
+          && reader.read(node.concentrations);
+      }
+    }
+    for (auto& link : links) {
+      success = success && reader.read(link.stack_delta_p) && reader.read(link.added_delta_p) && reader.read(link.delta_p)
+        && reader.read(link.flow) && reader.read(link.flow0) && reader.read(link.flow1) && reader.read(link.control)
+        && reader.read(link.nf);
+      for (auto& filters : link.filters) {
+        for (auto& filter : filters) {
+          success = success && reader.read(filter.control);
+        }
+      }
+    }
+    success = success && reader.read_fixed(p);
+    if (!success) {
+      errors.push_back("Failed to read checkpoint file \"" + filename + "\", model state is incomplete");
+      return false;
+    }
+    ++flow_version;
+    return true;
+  }
+
+  //bool explicit_transport(I cxi, std::vector<double>& CN, std::vector<double>& C0)
+  //{
+  //
+  //}
+
+  // Pressure differences across the links from the current pressures, only valid after setup()
+  void calculate_pressure_differences()
+  {
+    for (size_t k = 0; k < m_hot.size(); ++k) {
+      m_hot.delta_p[k] = p[m_hot.node0[k]] - p[m_hot.node1[k]] + m_hot.stack_delta_p[k] + m_hot.added_delta_p[k];
+    }
+  }
+
+  // Assemble the Jacobian and residuals from the current pressure differences, updating the flows
   void filjac()
   {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Filjac);
+    trace::Span span(tracer, "assembly", "airflow");
+    statistics.evaluate(m_evaluations);
     skyline->fill(0.0);
     std::fill(sum.begin(), sum.end(), 0.0);
     std::array<double, 2> F;
     std::array<double, 2> DF;
+    // The simulated nodes come first, so a node is variable if its index is less than n
+    I n{ static_cast<I>(simulated_nodes.size()) };
     // Loop over the links and build the Jacobian
-    size_t i = 0;
-    for (auto& link : links) {
-      if (link.node0.variable) {
-        int nf = link.element.calculate(false, link.delta_p, link.multiplier, link.control, link.node0, link.node1, F, DF);
+    for (size_t k = 0; k < m_hot.size(); ++k) {
+      I i{ m_hot.node0[k] };
+      I j{ m_hot.node1[k] };
+      if (i < n) {
+        int nf = m_hot.element[k]->calculate(false, m_hot.delta_p[k], m_hot.multiplier[k], m_hot.control[k], *m_ordered[i],
+          *m_ordered[j], F, DF);
         if (nf == 1) {
-          skyline->diagonal(link.node0.index) += DF[0];
-          sum[link.node0.index] += F[0];
-          if (link.node1.variable) {
-            (*skyline)(link.index1) -= DF[0];
-            skyline->diagonal(link.node1.index) += DF[0];
-            sum[link.node1.index] -= F[0];
+          skyline->diagonal(i) += DF[0];
+          sum[i] += F[0];
+          if (j < n) {
+            (*skyline)(m_hot.offset[k]) -= DF[0];
+            skyline->diagonal(j) += DF[0];
+            sum[j] -= F[0];
           }
-          link.flow = link.flow0 = F[0];
+          m_hot.flow[k] = F[0];
         } else {
           // Later
         }
       }
-      ++i;
     }
 
   }
 
+  // Memory held by the model, computed from the container capacities. The skyline part is
+  // estimated from the profile, since the matrix doesn't report its storage. Transport objects
+  // built on the model are not included, add their memory_usage() to the transport total.
+  memory::Usage memory_usage() const
+  {
+    memory::Usage usage;
+    usage.nodes = simulated_nodes.memory_usage() + fixed_nodes.memory_usage() + calculated_nodes.memory_usage() + memory::bytes(m_nodes);
+    usage.links = links.memory_usage();
+    usage.elements = powerlaw_elements.memory_usage() + contamx_powerlaw_elements.memory_usage() + memory::bytes(elements)
+      + memory::bytes(materials);
+    usage.names = names.memory_usage() + memory::bytes(name);
+    usage.lookups = memory::bytes(node_lookup) + memory::bytes(material_lookup) + memory::bytes(link_lookup)
+      + memory::bytes(element_lookup);
+    if (skyline) {
+      size_t n{ sum.size() };
+      usage.skyline = sizeof(*skyline) + (m_skyline_entries + n) * sizeof(double) + 2 * (n + 1) * sizeof(I);
+    }
+    usage.solver = memory::bytes(p) + memory::bytes(sum) + memory::bytes(m_ordered) + m_hot.memory_usage() + memory::bytes(m_flow_sign)
+      + memory::bytes(history.iterations) + memory::bytes(history.sign_changes);
+    for (auto nodes : { &simulated_nodes, &fixed_nodes, &calculated_nodes }) {
+      for (auto& node : *nodes) {
+        usage.transport += memory::bytes(node.concentrations);
+      }
+    }
+    for (auto& link : links) {
+      usage.transport += memory::bytes(link.filters);
+      for (auto& filters : link.filters) {
+        usage.transport += memory::bytes(filters);
+      }
+    }
+    usage.output = memory::bytes(m_outputs);
+    for (auto& channel : m_outputs) {
+      usage.output += channel.memory_usage();
+    }
+    return usage;
+  }
+
+  // Write the convergence history of the last steady solve and any oscillating links
+  void write_convergence_report(std::ostream& stream, unsigned threshold = 3) const
+  {
+    stream << "Iteration,ResidualNorm,MaxResidual,MaxResidualNode,MaxCorrection\n";
+    for (auto& el : history.iterations) {
+      stream << el.iteration << ',' << el.residual_norm << ',' << el.residual_max << ',' << names[el.node] << ',' << el.correction_max
+        << '\n';
+    }
+    stream << "Converged," << (history.converged ? "true" : "false") << "\n\nLink,SignChanges\n";
+    size_t k{ 0 };
+    for (auto& link : links) {
+      if (k < history.sign_changes.size() && history.sign_changes[k] >= threshold) {
+        stream << names[link.name] << ',' << history.sign_changes[k] << '\n';
+      }
+      ++k;
+    }
+  }
+
+private:
+  static signed char sign(double value)
+  {
+    return (value > 0.0) - (value < 0.0);
+  }
+
+  // Record the residuals left by filjac and count flow reversals, returns the largest residual
+  double record_iteration(int iteration)
+  {
+    double norm{ 0.0 };
+    double max{ 0.0 };
+    size_t node{ 0 };
+    for (size_t i = 0; i < sum.size(); ++i) {
+      norm += sum[i] * sum[i];
+      if (std::abs(sum[i]) > max) {
+        max = std::abs(sum[i]);
+        node = i;
+      }
+    }
+    Name name{ sum.empty() ? Name(0) : m_ordered[node]->name };
+    history.iterations.push_back({ static_cast<unsigned>(iteration), std::sqrt(norm), max, name, 0.0 });
+    for (size_t k = 0; k < m_hot.size(); ++k) {
+      signed char s{ sign(m_hot.flow[k]) };
+      if (s != 0) {
+        if (m_flow_sign[k] != 0 && s != m_flow_sign[k]) {
+          ++history.sign_changes[k];
+        }
+        m_flow_sign[k] = s;
+      }
+    }
+    return max;
+  }
+
+  // The skyline solver factors and back-substitutes in one call, so the time for both goes to factorization
+  void solve()
+  {
+    instrumentation::Scope scope(&statistics, instrumentation::Phase::Factorization);
+    trace::Span span(tracer, "factorization", "airflow");
+    skyline->ldlt_solve(sum);
+  }
+
+  static instrumentation::ElementType element_type(const Element<P>& element)
+  {
+    if (dynamic_cast<const PowerLaw<P>*>(&element)) {
+      return instrumentation::ElementType::PowerLaw;
+    } else if (dynamic_cast<const ContamXPowerLaw<P>*>(&element)) {
+      return instrumentation::ElementType::ContamXPowerLaw;
+    }
+    return instrumentation::ElementType::Other;
+  }
+
+  std::optional<I> find(const std::unordered_map<Name, I>& lookup, std::string_view name) const
+  {
+    auto id = names.find(name);
+    if (id) {
+      auto found = lookup.find(id.value());
+      if (found != lookup.end()) {
+        return found->second;
+      }
+    }
+    return {};
+  }
+
+  std::uint64_t signature() const
+  {
+    // Only the structure counts, the model name doesn't
+    std::uint64_t value{ checkpoint::hash("") };
+    for (auto nodes : { &simulated_nodes, &fixed_nodes, &calculated_nodes }) {
+      value = checkpoint::hash(std::to_string(nodes->size()), value);
+      for (auto& node : *nodes) {
+        value = checkpoint::hash(names[node.name], value);
+      }
+    }
+    value = checkpoint::hash(std::to_string(links.size()), value);
+    for (auto& link : links) {
+      value = checkpoint::hash(names[link.name], value);
+      value = checkpoint::hash(names[link.node0.name], value);
+      value = checkpoint::hash(names[link.node1.name], value);
+      for (auto& filters : link.filters) {
+        value = checkpoint::hash(std::to_string(filters.size()), value);
+      }
+    }
+    value = checkpoint::hash(std::to_string(materials.size()), value);
+    return value;
+  }
+
+  // Assign the solver indices (simulated nodes first) and size the solution vectors. Appending nodes
+  // keeps the relative order of the existing nodes, so links stay correctly oriented.
+  void renumber()
+  {
+    I i{ 0 };
+    p.resize(simulated_nodes.size() + fixed_nodes.size() + calculated_nodes.size());
+    sum.resize(simulated_nodes.size());
+    m_ordered.resize(p.size());
+    for (auto nodes : { &simulated_nodes, &fixed_nodes, &calculated_nodes }) {
+      for (auto& el : *nodes) {
+        el.index = i;
+        p[i] = el.pressure;
+        m_ordered[i] = &el;
+        ++i;
+      }
+    }
+    m_renumber = false;
+  }
+
+  I add_element(Element<P>& element)
+  {
+    I handle{ static_cast<I>(elements.size()) };
+    elements.push_back(&element);
+    element_lookup.emplace(element.name, handle);
+    return handle;
+  }
+
   bool load_materials(const pugi::xml_node& xml_materials)
   {
     bool success{ true };
@@ -421,7 +985,8 @@ private:
         continue;
       }
 
-      materials.emplace_back(name, default_conc);
+      materials.emplace_back(names.intern(name), default_conc);
+      material_lookup.emplace(materials.back().name, static_cast<I>(materials.size() - 1));
 
     }
 
@@ -469,61 +1034,20 @@ private:
         height += node.text().as_double();
       }
 
+      double p{ P::pressure_0 };
+      double T{ P::temperature_0 };
+      double W{ P::humidity_ratio_0 };
       node = el.child("DefaultState");
       if (node) {
-        double p, T, W;
         std::string label = "Node \"" + name + "\"";
         success &= load_state(node, label, p, T, W);
-
-        switch (type) {
-        case NodeType::Simulated:
-          simulated_nodes.emplace_back(name, height, p, T, W);
-          break;
-        case NodeType::Fixed:
-          fixed_nodes.emplace_back(name, height, p, T, W);
-          break;
-        case NodeType::Calculated:
-          calculated_nodes.emplace_back(name, height, p, T, W);
-          break;
-        }
-      } else {
-        switch (type) {
-        case NodeType::Simulated:
-          simulated_nodes.emplace_back(name, height);
-          break;
-        case NodeType::Fixed:
-          fixed_nodes.emplace_back(name, height);
-          break;
-        case NodeType::Calculated:
-          calculated_nodes.emplace_back(name, height);
-          break;
-        }
       }
+      success &= add_node(name, type, height, p, T, W).has_value();
     }
 
     if (success) {
-      // Build the overall lookup table, set up the pressure vector, and assign indices
-      I i{ 0 };
-      p.resize(simulated_nodes.size() + calculated_nodes.size() + fixed_nodes.size());
-      sum.resize(simulated_nodes.size());
-      for (auto& el : simulated_nodes) {
-        node_lookup.emplace(el.name, el);
-        el.variable = true;
-        el.index = i;
-        ++i;
-      }
-      for (auto& el : fixed_nodes) {
-        node_lookup.emplace(el.name, el);
-        el.index = i;
-        p[i] = el.pressure;
-        ++i;
-      }
-      for (auto& el : calculated_nodes) {
-        node_lookup.emplace(el.name, el);
-        el.index = i;
-        p[i] = el.pressure;
-        ++i;
-      }
+      // Set up the pressure vector and assign indices
+      renumber();
     }
 
     return success;
@@ -615,42 +1139,110 @@ private:
         continue;
       }
       // Find the element
-      auto found_element = element_lookup.find(element_id);
-      if (found_element == element_lookup.end()) {
+      auto found_element = find_element(element_id);
+      if (!found_element) {
         errors.push_back("Element \"" + element_id + "\" specified in link \"" + name + "\" does not exist");
         success = false;
         continue;
       }
-      auto element_ref{ found_element->second };
 
       // Find the nodes
-      std::cout << n_name[0] << ' ' << n_name[1] << std::endl;
-      auto found_node = node_lookup.find(n_name[0]);
-      if (found_node == node_lookup.end()) {
+      auto node0 = find_node(n_name[0]);
+      if (!node0) {
         errors.push_back("Node \"" + n_name[0] + "\" specified in link \"" + name + "\" does not exist");
         success = false;
         continue;
       }
-      auto node0_ref{ found_node->second };
 
-      found_node = node_lookup.find(n_name[1]);
-      if (found_node == node_lookup.end()) {
+      auto node1 = find_node(n_name[1]);
+      if (!node1) {
         errors.push_back("Node \"" + n_name[1] + "\" specified in link \"" + name + "\" does not exist");
         success = false;
         continue;
       }
-      auto node1_ref{ found_node->second };
 
-#ifdef UNORDERED_NODES
-      links.emplace_back(name, node0_ref, node1_ref, element_ref, h[0], h[1], 0.0, 0.0, multiplier);
-#else
-      if (node0_ref.get().index < node1_ref.get().index) {
-        links.emplace_back(name, node0_ref, node1_ref, element_ref, h[0], h[1], 0.0, 0.0, multiplier);
+      success &= add_link(name, node0.value(), node1.value(), found_element.value(), h[0], h[1], multiplier).has_value();
+    }
+    return success;
+  }
+
+  bool load_outputs(const pugi::xml_node& xml_outputs)
+  {
+    bool success{ true };
+    int output_count{ 0 };
+    for (pugi::xml_node el : xml_outputs.children("Output")) {
+      ++output_count;
+      auto node = el.child("FileName");
+      if (!node) {
+        errors.push_back("Output #" + std::to_string(output_count) + " does not have a file name");
+        success = false;
+        continue;
+      }
+      std::string filename = node.text().as_string();
+      std::string label = "Output \"" + filename + "\"";
+
+      output::Variable variable;
+      std::string text = el.child("Variable").text().as_string();
+      if (text == "Pressure") {
+        variable = output::Variable::Pressure;
+      } else if (text == "Flow") {
+        variable = output::Variable::Flow;
       } else {
-        links.emplace_back(name, node1_ref, node0_ref, element_ref, h[1], h[0], 0.0, 0.0, multiplier);
+        errors.push_back(label + " variable \"" + text + "\" is not recognized");
+        success = false;
+        continue;
+      }
+
+      std::vector<std::string> patterns;
+      for (pugi::xml_node match : el.children("Match")) {
+        patterns.push_back(match.text().as_string());
+      }
+      if (patterns.empty()) {
+        patterns.push_back("*");
+      }
+
+      // The interval is a number of seconds or one of the named intervals, every timestep by default
+      double interval{ 0.0 };
+      node = el.child("Interval");
+      if (node) {
+        text = node.text().as_string();
+        if (text == "Hourly") {
+          interval = output::hourly;
+        } else if (text == "Daily") {
+          interval = output::daily;
+        } else if (text != "Timestep") {
+          interval = node.text().as_double();
+          if (!(interval > 0.0)) {
+            errors.push_back(label + " interval \"" + text + "\" is not recognized");
+            success = false;
+            continue;
+          }
+        }
+      }
+
+      unsigned statistics{ 0 };
+      for (pugi::xml_node statistic : el.children("Statistic")) {
+        text = statistic.text().as_string();
+        if (text == "Minimum") {
+          statistics |= output::Statistic::Minimum;
+        } else if (text == "Maximum") {
+          statistics |= output::Statistic::Maximum;
+        } else if (text == "Mean") {
+          statistics |= output::Statistic::Mean;
+        } else if (text == "Integral") {
+          statistics |= output::Statistic::Integral;
+        } else if (text == "All") {
+          statistics |= output::Statistic::All;
+        } else {
+          errors.push_back(label + " statistic \"" + text + "\" is not recognized");
+          success = false;
+        }
+      }
+      if (statistics == 0) {
+        statistics = output::Statistic::Mean;
       }
-#endif
 
+      output_specifications.emplace_back(filename, variable, patterns, interval, statistics);
     }
     return success;
   }
@@ -757,31 +1349,31 @@ private:
 
     // Stop here for now, only support AIRNET/E+ max flow selection
     if (contam) {
-      contamx_powerlaw_elements.emplace_back(id, coefficient, laminar_coefficient, exponent);
+      return add_contamx_powerlaw(id, coefficient, laminar_coefficient, exponent).has_value();
     } else {
       node = element.child("ReferenceState");
       if (node) {
         double p0, T0, w0;
         std::string label = "Power law element \"" + id + "\"";
         if (load_state(node, label, p0, T0, w0)) {
-          powerlaw_elements.emplace_back(id, coefficient, laminar_coefficient, exponent, p0, T0, w0);
+          return add_powerlaw(id, coefficient, laminar_coefficient, exponent, p0, T0, w0).has_value();
         } else {
           // TODO: Handle failure here
           errors.push_back("Failed to load power law element \"" + id + "\"");
         }
       } else {
-        powerlaw_elements.emplace_back(id, coefficient, laminar_coefficient, exponent);
+        return add_powerlaw(id, coefficient, laminar_coefficient, exponent).has_value();
       }
     }
     
     return true;
   }
 
-  bool load_elements(const pugi::xml_node& elements)
+  bool load_elements(const pugi::xml_node& xml_elements)
   {
     bool success{ true };
     int count = 1;
-    for (auto& node : elements.children("PowerLaw")) {
+    for (auto& node : xml_elements.children("PowerLaw")) {
       success |= load_powerlaw(node, count);
       ++count;
     }
@@ -790,49 +1382,61 @@ private:
     }
     // Load other elements here
 
-    // Build the lookup table
-    for (auto& el : powerlaw_elements) {
-      // Check for clashes?
-      element_lookup.emplace(el.name, el);
-    }
-
-    for (auto& el : contamx_powerlaw_elements) {
-      // Check for clashes?
-      element_lookup.emplace(el.name, el);
-    }
     return success;
   }
 
 public:
   std::string name;
 
-  std::unordered_map<std::string, std::reference_wrapper<Node<I,P>>> node_lookup;
-  //std::unordered_map<std::string, Node<I, P>&> node_lookup;
-  std::vector<Node<I,P>> simulated_nodes;
-  std::vector<Node<I,P>> fixed_nodes;
-  std::vector<Node<I,P>> calculated_nodes;
+  NameTable names; // Object names are only needed for I/O, everything else uses integer handles
+
+  std::unordered_map<Name, I> node_lookup;
+  Arena<Node<I,P>> simulated_nodes;
+  Arena<Node<I,P>> fixed_nodes;
+  Arena<Node<I,P>> calculated_nodes;
 
+  std::unordered_map<Name, I> material_lookup;
   std::vector<Material> materials;
 
-  std::vector<Link<I,P>> links;
+  std::unordered_map<Name, I> link_lookup;
+  Arena<Link<I,P>> links;
 
-  std::unordered_map<std::string, std::reference_wrapper<Element<P>>> element_lookup;
-  //std::unordered_map<std::string, Element<P>&> element_lookup;
-  std::vector<PowerLaw<P>> powerlaw_elements;
-  std::vector<ContamXPowerLaw<P>> contamx_powerlaw_elements;
+  std::unordered_map<Name, I> element_lookup;
+  std::vector<Element<P>*> elements;
+  Arena<PowerLaw<P>> powerlaw_elements;
+  Arena<ContamXPowerLaw<P>> contamx_powerlaw_elements;
 
   std::vector<std::string> errors;
   std::vector<std::string> warnings;
 
+  std::vector<output::Specification> output_specifications; // From the XML, opened by open_output()
+
   std::vector<double> p; // Current pressure value, sized to match the total number of nodes
   std::vector<double> sum; // RHS for solution, sized to match the number of simulated nodes
 
   std::unique_ptr<skyline::SymmetricMatrix<I, double, std::vector>> skyline;
   double tolerance;
+  bool verbose{ true }; // Print the residual for each iteration and convergence failures
+
+  // Incremented whenever the model changes the link flows, increment it after changing flows or filter
+  // controls by hand so that transport steppers know to refactor
+  std::uint64_t flow_version{ 0 };
+
+  instrumentation::Statistics statistics; // Only collected when built with AIRFLOWNETWORK_INSTRUMENTATION
+  trace::Recorder* tracer{ nullptr }; // Set to record trace spans for the solver
+  int max_iterations{ 25 }; // Newton iterations allowed in a steady solve, set with set_max_iterations() after setup()
+  convergence::History history; // Of the last steady solve
 
 private:
-  std::unique_ptr<std::ofstream> m_pressure_output;
-  std::unique_ptr<std::ofstream> m_flow_output;
+  std::vector<Node<I,P>*> m_nodes; // Indexed by node handle
+  std::vector<const Node<I,P>*> m_ordered; // Indexed by solver index
+  LinkArrays<I,P> m_hot; // Solver copy of the link data, in the same order as the links
+  bool m_renumber{ false };
+  std::vector<signed char> m_flow_sign; // Last nonzero flow direction of each link
+  size_t m_skyline_entries{ 0 }; // Off-diagonal entries in the skyline profile
+  std::array<std::uint64_t, instrumentation::element_type_count> m_evaluations{}; // Per filjac call
+
+  std::vector<output::Channel> m_outputs;
 
 };
 
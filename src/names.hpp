@@ -0,0 +1,137 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_NAMES_HPP
+#define AIRFLOWNETWORK_NAMES_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <limits>
+#include <cstdint>
+
+namespace airflownetwork {
+
+typedef std::uint32_t Name;
+
+// Interned object names. Each distinct name is stored once, null-terminated, in a single character
+// array and identified by a dense integer handle. Lookups go through an open addressing table of
+// handles, so the only per-name overhead is an offset and a couple of table slots.
+class NameTable
+{
+public:
+  Name intern(std::string_view name)
+  {
+    if (2 * (m_offsets.size() + 1) > m_slots.size()) {
+      rehash(m_slots.empty() ? 16 : 2 * m_slots.size());
+    }
+    size_t i{ slot(name) };
+    if (m_slots[i] != empty) {
+      return m_slots[i];
+    }
+    Name id{ static_cast<Name>(m_offsets.size()) };
+    m_offsets.push_back(static_cast<std::uint32_t>(m_chars.size()));
+    m_chars.insert(m_chars.end(), name.begin(), name.end());
+    m_chars.push_back('\0');
+    m_slots[i] = id;
+    return id;
+  }
+
+  std::optional<Name> find(std::string_view name) const
+  {
+    if (m_slots.empty()) {
+      return {};
+    }
+    Name id{ m_slots[slot(name)] };
+    if (id == empty) {
+      return {};
+    }
+    return id;
+  }
+
+  std::string_view operator[](Name id) const
+  {
+    size_t end{ id + 1 < m_offsets.size() ? m_offsets[id + 1] : m_chars.size() };
+    return std::string_view(&m_chars[m_offsets[id]], end - m_offsets[id] - 1);
+  }
+
+  const char* c_str(Name id) const
+  {
+    return &m_chars[m_offsets[id]];
+  }
+
+  size_t size() const
+  {
+    return m_offsets.size();
+  }
+
+  size_t memory_usage() const
+  {
+    return m_chars.capacity() + m_offsets.capacity() * sizeof(std::uint32_t) + m_slots.capacity() * sizeof(Name);
+  }
+
+private:
+  static constexpr Name empty{ std::numeric_limits<Name>::max() };
+
+  static size_t hash(std::string_view name)
+  {
+    std::uint64_t value{ 14695981039346656037ull };
+    for (unsigned char c : name) {
+      value ^= c;
+      value *= 1099511628211ull;
+    }
+    return static_cast<size_t>(value ^ (value >> 32));
+  }
+
+  // Find the slot that holds a name or the empty slot where it would go
+  size_t slot(std::string_view name) const
+  {
+    size_t mask{ m_slots.size() - 1 };
+    size_t i{ hash(name) & mask };
+    while (m_slots[i] != empty && (*this)[m_slots[i]] != name) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void rehash(size_t size)
+  {
+    m_slots.assign(size, empty);
+    for (Name id = 0; id < m_offsets.size(); ++id) {
+      m_slots[slot((*this)[id])] = id;
+    }
+  }
+
+  std::vector<char> m_chars;
+  std::vector<std::uint32_t> m_offsets;
+  std::vector<Name> m_slots;
+};
+
+}
+
+#endif // !AIRFLOWNETWORK_NAMES_HPP
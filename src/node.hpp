@@ -30,6 +30,7 @@
 
 #include <string>
 #include "properties.hpp"
+#include "names.hpp"
 
 namespace airflownetwork {
 
@@ -37,12 +38,12 @@ enum class NodeType {Simulated, Fixed, Calculated};
 
 template <typename I, typename P> struct Node : State<P>
 {
-  Node(const std::string &name, double height=0.0, double pressure=P::pressure_0, double temperature = P::temperature_0,
+  Node(Name name, double height=0.0, double pressure=P::pressure_0, double temperature = P::temperature_0,
     double humidity_ratio=P::humidity_ratio_0) : State<P>(pressure, temperature, humidity_ratio), name(name), height(height),
     variable(false), index(0)
   {}
 
-  const std::string name;
+  const Name name;
   double height;
   bool variable;
   I index;
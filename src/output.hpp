@@ -0,0 +1,281 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_OUTPUT_HPP
+#define AIRFLOWNETWORK_OUTPUT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <ostream>
+#include <fstream>
+#include <cstdio>
+
+namespace airflownetwork {
+namespace output {
+
+enum class Variable { Pressure, Flow };
+
+// Statistics are bit flags so that a channel can report several of them at once
+enum Statistic : unsigned { Minimum = 0x1, Maximum = 0x2, Mean = 0x4, Integral = 0x8, All = 0xF };
+
+const double hourly{ 3600.0 };
+const double daily{ 86400.0 };
+
+// Glob-style matching of object names, '*' matches any run of characters and '?' matches any one character
+inline bool match(std::string_view pattern, std::string_view name)
+{
+  size_t p{ 0 }, n{ 0 };
+  size_t star{ std::string_view::npos }, mark{ 0 };
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      ++p;
+      ++n;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      mark = n;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      n = ++mark;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+
+inline bool match(const std::vector<std::string>& patterns, std::string_view name)
+{
+  for (auto& pattern : patterns) {
+    if (match(pattern, name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct Specification
+{
+  Specification(const std::string& filename, Variable variable, const std::vector<std::string>& patterns = { "*" }, double interval = 0.0,
+    unsigned statistics = Statistic::Mean) : filename(filename), variable(variable), patterns(patterns), interval(interval), statistics(statistics)
+  {}
+
+  std::string filename;
+  Variable variable;
+  std::vector<std::string> patterns;
+  double interval; // Reporting interval in seconds, zero or less writes every value
+  unsigned statistics;
+};
+
+// Streaming statistics for a value that is held constant over the time since the previous sample
+struct Accumulator
+{
+  void reset()
+  {
+    minimum = std::numeric_limits<double>::max();
+    maximum = std::numeric_limits<double>::lowest();
+    integral = 0.0;
+    duration = 0.0;
+    count = 0;
+  }
+
+  void add(double value, double dt)
+  {
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+    integral += value * dt;
+    duration += dt;
+    last = value;
+    ++count;
+  }
+
+  double mean() const
+  {
+    if (duration > 0.0) {
+      return integral / duration;
+    }
+    return last;
+  }
+
+  double minimum{ std::numeric_limits<double>::max() };
+  double maximum{ std::numeric_limits<double>::lowest() };
+  double integral{ 0.0 };
+  double duration{ 0.0 };
+  double last{ 0.0 };
+  unsigned count{ 0 };
+};
+
+struct Channel
+{
+  Channel(std::unique_ptr<std::ostream> stream, double interval = 0.0, unsigned statistics = Statistic::Mean) : interval(interval),
+    statistics(statistics == 0 ? Statistic::Mean : statistics), m_stream(std::move(stream))
+  {}
+
+  void add(const std::string& label, const double* source)
+  {
+    labels.push_back(label);
+    sources.push_back(source);
+    m_accumulators.emplace_back();
+  }
+
+  void write_header()
+  {
+    *m_stream << "Time(s)";
+    for (auto& label : labels) {
+      if (interval > 0.0) {
+        if (statistics & Statistic::Minimum) {
+          *m_stream << ',' << label << ":Minimum";
+        }
+        if (statistics & Statistic::Maximum) {
+          *m_stream << ',' << label << ":Maximum";
+        }
+        if (statistics & Statistic::Mean) {
+          *m_stream << ',' << label << ":Mean";
+        }
+        if (statistics & Statistic::Integral) {
+          *m_stream << ',' << label << ":Integral";
+        }
+      } else {
+        *m_stream << ',' << label;
+      }
+    }
+    *m_stream << std::endl;
+  }
+
+  void record(double seconds)
+  {
+    if (interval <= 0.0) {
+      *m_stream << seconds;
+      for (auto source : sources) {
+        *m_stream << ',' << *source;
+      }
+      *m_stream << '\n';
+      return;
+    }
+    if (!m_started) {
+      // The first sample only seeds the extrema, there's no elapsed time to integrate over
+      m_started = true;
+      m_last_time = seconds;
+      m_next_time = (std::floor(seconds / interval) + 1.0) * interval;
+      accumulate(0.0);
+      return;
+    }
+    // Split the elapsed time across any reporting boundaries that were passed
+    while (seconds > m_next_time) {
+      accumulate(m_next_time - m_last_time);
+      m_last_time = m_next_time;
+      emit(m_next_time);
+      m_next_time += interval;
+    }
+    accumulate(seconds - m_last_time);
+    m_last_time = seconds;
+    if (seconds == m_next_time) {
+      emit(m_next_time);
+      m_next_time += interval;
+    }
+  }
+
+  // Write out any partial reporting interval, the stream is closed when the channel is destroyed
+  void finish()
+  {
+    if (interval > 0.0 && m_pending) {
+      emit(m_last_time);
+    }
+    m_stream->flush();
+  }
+
+  // Bytes held by the channel, the stream buffer size is a typical value rather than a measurement
+  size_t memory_usage() const
+  {
+    size_t bytes{ labels.capacity() * sizeof(std::string) + sources.capacity() * sizeof(const double*)
+      + m_accumulators.capacity() * sizeof(Accumulator) };
+    for (auto& label : labels) {
+      if (label.capacity() > std::string().capacity()) {
+        bytes += label.capacity() + 1;
+      }
+    }
+    if (m_stream) {
+      bytes += sizeof(std::ofstream) + BUFSIZ;
+    }
+    return bytes;
+  }
+
+  const double interval;
+  const unsigned statistics;
+  std::vector<std::string> labels;
+  std::vector<const double*> sources;
+
+private:
+  void accumulate(double dt)
+  {
+    for (size_t i = 0; i < sources.size(); ++i) {
+      m_accumulators[i].add(*sources[i], dt);
+    }
+    m_pending = true;
+  }
+
+  void emit(double seconds)
+  {
+    *m_stream << seconds;
+    for (auto& acc : m_accumulators) {
+      if (statistics & Statistic::Minimum) {
+        *m_stream << ',' << acc.minimum;
+      }
+      if (statistics & Statistic::Maximum) {
+        *m_stream << ',' << acc.maximum;
+      }
+      if (statistics & Statistic::Mean) {
+        *m_stream << ',' << acc.mean();
+      }
+      if (statistics & Statistic::Integral) {
+        *m_stream << ',' << acc.integral;
+      }
+      acc.reset();
+    }
+    *m_stream << '\n';
+    m_pending = false;
+  }
+
+  std::unique_ptr<std::ostream> m_stream;
+  std::vector<Accumulator> m_accumulators;
+  double m_last_time{ 0.0 };
+  double m_next_time{ 0.0 };
+  bool m_started{ false };
+  bool m_pending{ false };
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_OUTPUT_HPP
@@ -61,7 +61,7 @@ template <typename P> struct PowerLaw : public Element<P> // Surface crack compo
   const double referenceT;   // Reference temperature for crack data
   const double referenceW;   // Reference humidity ratio for crack data
 
-  PowerLaw(const std::string &name, double coefficient, double laminar_coefficient, double exponent=0.65, double referenceP=101325.0, double referenceT=20.0,
+  PowerLaw(Name name, double coefficient, double laminar_coefficient, double exponent=0.65, double referenceP=101325.0, double referenceT=20.0,
     double referenceW=0.0) : Element<P>(name), coefficient(validate_coefficient(coefficient)), laminar_coefficient(validate_coefficient(laminar_coefficient)), 
     exponent(validate_exponent(exponent,0.65)), referenceP(validate_pressure(referenceP, 101325.0)), referenceT(validate_pressure(referenceT, 20.0)),
     referenceW(validate_pressure(referenceW, 0.0))
@@ -196,7 +196,7 @@ template <typename P> struct ContamXPowerLaw : public Element<P> // Surface crac
   const double exponent;     // Air Mass Flow exponent [dimensionless]
 
   // Default Constructor
-  ContamXPowerLaw(const std::string& name, double coefficient, double laminar_coefficient, double exponent = 0.65) : Element<P>(name), coefficient(validate_coefficient(coefficient)),
+  ContamXPowerLaw(Name name, double coefficient, double laminar_coefficient, double exponent = 0.65) : Element<P>(name), coefficient(validate_coefficient(coefficient)),
     laminar_coefficient(validate_coefficient(laminar_coefficient)), exponent(validate_exponent(exponent, 0.65))
   {}
 
@@ -0,0 +1,246 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_PROFILE_HPP
+#define AIRFLOWNETWORK_PROFILE_HPP
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "filters.hpp"
+
+namespace airflownetwork {
+
+// Nonsymmetric matrix in profile (skyline) storage with an in-place LU factorization. The upper triangle
+// is stored by columns and the lower triangle by rows, each with its own profile. The values are stored
+// in one array with the diagonal first, so index(i, i) == i. There is no pivoting, which is fine for
+// transport systems since those are diagonally dominant.
+template <typename I> class ProfileMatrix
+{
+public:
+  ProfileMatrix(const std::vector<I>& upper, const std::vector<I>& lower) : m_n(static_cast<I>(upper.size())), m_upper(upper),
+    m_lower(lower), m_upper_start(upper.size() + 1), m_lower_start(lower.size() + 1)
+  {
+    m_upper_start[0] = m_n;
+    for (I j = 0; j < m_n; ++j) {
+      m_upper_start[j + 1] = m_upper_start[j] + m_upper[j];
+    }
+    m_lower_start[0] = m_upper_start[m_n];
+    for (I i = 0; i < m_n; ++i) {
+      m_lower_start[i + 1] = m_lower_start[i] + m_lower[i];
+    }
+    m_values.resize(m_lower_start[m_n], 0.0);
+  }
+
+  explicit ProfileMatrix(const std::vector<I>& heights) : ProfileMatrix(heights, heights)
+  {}
+
+  // Profile heights for a set of links, using the node indices as the ordering. Both flow directions are
+  // included, so the same heights serve for the upper and lower profiles.
+  template <typename L> static std::vector<I> heights(I n, const L& links)
+  {
+    std::vector<I> h(n, 0);
+    for (auto& link : links) {
+      I i = static_cast<I>(link.node0.index);
+      I j = static_cast<I>(link.node1.index);
+      if (i > j) {
+        std::swap(i, j);
+      }
+      h[j] = std::max(h[j], static_cast<I>(j - i));
+    }
+    return h;
+  }
+
+  I rows() const
+  {
+    return m_n;
+  }
+
+  // Total number of stored values, including the diagonal
+  size_t size() const
+  {
+    return m_values.size();
+  }
+
+  void fill(double value)
+  {
+    std::fill(m_values.begin(), m_values.end(), value);
+  }
+
+  void scale(double value)
+  {
+    for (auto& v : m_values) {
+      v *= value;
+    }
+  }
+
+  double& diagonal(I i)
+  {
+    return m_values[i];
+  }
+
+  // Location of entry (i, j) in the value array, if it is inside the profile
+  std::optional<I> index(I i, I j) const
+  {
+    if (i == j) {
+      return i;
+    } else if (i < j) {
+      if (j - i > m_upper[j]) {
+        return {};
+      }
+      return m_upper_start[j + 1] - (j - i);
+    }
+    if (i - j > m_lower[i]) {
+      return {};
+    }
+    return m_lower_start[i + 1] - (i - j);
+  }
+
+  double& operator()(I k)
+  {
+    return m_values[k];
+  }
+
+  // Entry (i, j), which must be inside the profile
+  double& operator()(I i, I j)
+  {
+    return m_values[*index(i, j)];
+  }
+
+  // Factor in place into a unit lower triangular L and an upper triangular U, returns false on a zero pivot
+  bool lu()
+  {
+    for (I j = 0; j < m_n; ++j) {
+      I uj = j - m_upper[j]; // First row in column j of U
+      I lj = j - m_lower[j]; // First column in row j of L
+      // Column j of U
+      for (I i = uj; i < j; ++i) {
+        I li = i - m_lower[i];
+        double sum = 0.0;
+        for (I k = std::max(li, uj); k < i; ++k) {
+          sum += lower(i, k) * upper(k, j);
+        }
+        upper(i, j) -= sum;
+      }
+      // Row j of L
+      for (I i = lj; i < j; ++i) {
+        I ui = i - m_upper[i];
+        double sum = 0.0;
+        for (I k = std::max(ui, lj); k < i; ++k) {
+          sum += lower(j, k) * upper(k, i);
+        }
+        lower(j, i) = (lower(j, i) - sum) / m_values[i];
+      }
+      // Diagonal
+      double sum = 0.0;
+      for (I k = std::max(uj, lj); k < j; ++k) {
+        sum += lower(j, k) * upper(k, j);
+      }
+      m_values[j] -= sum;
+      if (m_values[j] == 0.0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Solve in place with the factors computed by lu()
+  template <typename V> void solve(V& b) const
+  {
+    // Forward substitution with L, by rows
+    for (I i = 0; i < m_n; ++i) {
+      I k0 = i - m_lower[i];
+      const double* row = m_values.data() + m_lower_start[i];
+      double sum = 0.0;
+      for (I k = k0; k < i; ++k) {
+        sum += row[k - k0] * b[k];
+      }
+      b[i] -= sum;
+    }
+    // Back substitution with U, by columns
+    for (I j = m_n; j-- > 0;) {
+      b[j] /= m_values[j];
+      I k0 = j - m_upper[j];
+      const double* column = m_values.data() + m_upper_start[j];
+      for (I k = k0; k < j; ++k) {
+        b[k] -= column[k - k0] * b[j];
+      }
+    }
+  }
+
+private:
+  double& upper(I i, I j)
+  {
+    return m_values[m_upper_start[j + 1] - (j - i)];
+  }
+
+  double& lower(I i, I j)
+  {
+    return m_values[m_lower_start[i + 1] - (i - j)];
+  }
+
+  I m_n;
+  std::vector<I> m_upper;
+  std::vector<I> m_lower;
+  std::vector<I> m_upper_start;
+  std::vector<I> m_lower_start;
+  std::vector<double> m_values;
+};
+
+namespace transport {
+
+// Fill a profile matrix directly, the entry locations are computed from the profile without searching
+template <typename L, typename I, typename K> void matrix(const K& key, ProfileMatrix<I>& matrix, L& links)
+{
+  matrix.fill(0.0);
+  for (auto& link : links) {
+    I i = static_cast<I>(link.node0.index);
+    I j = static_cast<I>(link.node1.index);
+    for_each_flux(link, key, [&](auto entry, double value) {
+      switch (entry) {
+      case Flux::Diagonal0:
+        matrix.diagonal(i) += value;
+        break;
+      case Flux::Diagonal1:
+        matrix.diagonal(j) += value;
+        break;
+      case Flux::Lower:
+        matrix(j, i) += value;
+        break;
+      case Flux::Upper:
+        matrix(i, j) += value;
+        break;
+      }
+    });
+  }
+}
+
+}
+
+}
+
+#endif // !AIRFLOWNETWORK_PROFILE_HPP
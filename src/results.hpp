@@ -31,6 +31,7 @@
 #include <string>
 #include <vector>
 #include "properties.hpp"
+#include "names.hpp"
 
 namespace airflownetwork {
 
@@ -62,13 +63,13 @@ template <typename L> struct FlowResult
 
 template <typename L> struct Results
 {
-  bool load(const pugi::xml_node& root, std::vector<L>& links)
+  template <typename C> bool load(const pugi::xml_node& root, C& links, const NameTable& names)
   {
     bool success{ true };
     // Get the data from the XML
     auto flows = root.child("FlowResults");
     if (flows) {
-      success &= load_flow_results(flows, links);
+      success &= load_flow_results(flows, links, names);
     }
 
     return success;
@@ -80,7 +81,7 @@ template <typename L> struct Results
   std::vector<std::string> warnings;
 
 private:
-  bool load_flow_results(const pugi::xml_node& flows, std::vector<L>& links)
+  template <typename C> bool load_flow_results(const pugi::xml_node& flows, C& links, const NameTable& names)
   {
     bool success{ true };
     int count{ 0 };
@@ -116,14 +117,15 @@ private:
           double flow = f.text().as_double();
           auto attr = f.attribute("IDref");
           if (attr) {
-            std::string name = attr.as_string();
-            //std::cout << name << std::endl;
+            auto name = names.find(attr.as_string());
             bool found{ false };
-            for (auto& el : links) {
-              if (el.name == name) {
-                found = true;
-                flows.emplace_back(el, flow);
-                break;
+            if (name) {
+              for (auto& el : links) {
+                if (el.name == name.value()) {
+                  found = true;
+                  flows.emplace_back(el, flow);
+                  break;
+                }
               }
             }
             if (!found) {
@@ -59,7 +59,7 @@ template <typename P> struct BasicOpening : public PowerLaw<P> // Very basic ope
   const double width;
   const double discharge_coefficient;
 
-  BasicOpening(const std::string &name, double height, double width, double min_diff, double discharge_coeff, double coefficient, double laminar_coefficient,
+  BasicOpening(Name name, double height, double width, double min_diff, double discharge_coeff, double coefficient, double laminar_coefficient,
     double exponent=0.5, double referenceP=101325.0, double referenceT=20.0, double referenceW=0.0) : 
     PowerLaw<P>(name, coefficient, laminar_coefficient, exponent, referenceP, referenceT, referenceW), height(height), width(width),
     discharge_coefficient(validate_coefficient(discharge_coeff))
@@ -223,7 +223,7 @@ template <typename P> struct SimpleOpening : public PowerLaw<P> // Simple openin
   const double min_density_difference;
   const double discharge_coefficient;
 
-  SimpleOpening(const std::string &name, double height, double width, double min_diff, double discharge_coeff, double coefficient, double laminar_coefficient,
+  SimpleOpening(Name name, double height, double width, double min_diff, double discharge_coeff, double coefficient, double laminar_coefficient,
     double exponent=0.65, double referenceP=101325.0, double referenceT=20.0, double referenceW=0.0) : 
     PowerLaw<P>(name, coefficient, laminar_coefficient, exponent, referenceP, referenceT, referenceW), height(height), width(width),
     min_density_difference(validate_coefficient(min_diff)), discharge_coefficient(validate_coefficient(discharge_coeff))
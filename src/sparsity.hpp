@@ -0,0 +1,235 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_SPARSITY_HPP
+#define AIRFLOWNETWORK_SPARSITY_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "filters.hpp"
+#include "memory.hpp"
+#include "Eigen/SparseCore"
+
+namespace airflownetwork {
+namespace transport {
+
+// Fixed structure of a transport matrix. The pattern includes every diagonal entry and the entries
+// for both flow directions of every link, so it does not change when the flows do. The location of
+// each entry in the matrix value array is computed once and used to refill the matrix directly.
+template <typename M> struct Pattern
+{
+  static_assert(!M::IsRowMajor, "The entry locations are found by searching the columns of a column-major matrix");
+  typedef typename M::StorageIndex Index;
+
+  struct Offsets
+  {
+    Index diagonal0; // (node0, node0)
+    Index diagonal1; // (node1, node1)
+    Index lower;     // (node1, node0), flow from node 0 into node 1
+    Index upper;     // (node0, node1), flow from node 1 into node 0
+  };
+
+  Pattern() = default;
+
+  template <typename L> Pattern(Index size, const L& links, M& matrix)
+  {
+    build(size, links, matrix);
+  }
+
+  // Set up the structure of the matrix for the links, the matrix is resized and zeroed
+  template <typename L> void build(Index size, const L& links, M& matrix)
+  {
+    std::vector<Eigen::Triplet<double, Index>> entries;
+    entries.reserve(size + 2 * links.size());
+    for (Index i = 0; i < size; ++i) {
+      entries.emplace_back(i, i, 0.0);
+    }
+    for (auto& link : links) {
+      entries.emplace_back(static_cast<Index>(link.node1.index), static_cast<Index>(link.node0.index), 0.0);
+      entries.emplace_back(static_cast<Index>(link.node0.index), static_cast<Index>(link.node1.index), 0.0);
+    }
+    matrix.resize(size, size);
+    matrix.setFromTriplets(entries.begin(), entries.end());
+    matrix.makeCompressed();
+
+    diagonal.resize(size);
+    for (Index i = 0; i < size; ++i) {
+      diagonal[i] = find(matrix, i, i);
+    }
+    offsets.clear();
+    offsets.reserve(links.size());
+    for (auto& link : links) {
+      Index i = static_cast<Index>(link.node0.index);
+      Index j = static_cast<Index>(link.node1.index);
+      offsets.push_back({ diagonal[i], diagonal[j], find(matrix, j, i), find(matrix, i, j) });
+    }
+  }
+
+  // Bytes held by the entry locations, the matrix reports its own storage
+  size_t memory_usage() const
+  {
+    return memory::bytes(diagonal) + memory::bytes(offsets);
+  }
+
+  std::vector<Index> diagonal; // Location of the diagonal entry for each node
+  std::vector<Offsets> offsets; // Locations of the entries for each link, in link order
+
+private:
+  static Index find(const M& matrix, Index row, Index col)
+  {
+    auto begin = matrix.innerIndexPtr() + matrix.outerIndexPtr()[col];
+    auto end = matrix.innerIndexPtr() + matrix.outerIndexPtr()[col + 1];
+    return static_cast<Index>(std::lower_bound(begin, end, row) - matrix.innerIndexPtr());
+  }
+};
+
+// Cached filter pass-through factors for each link and species, stored species by species so that the
+// factors for one species are contiguous and in link order. A negative factor marks a link that blocks
+// the species entirely, and those links are also listed separately.
+template <typename I> struct PassThrough
+{
+  PassThrough() = default;
+
+  template <typename L> PassThrough(const L& links, size_t species)
+  {
+    build(links, species);
+  }
+
+  template <typename L> void build(const L& links, size_t species)
+  {
+    m_links = links.size();
+    factors.resize(m_links * species);
+    blocked.assign(species, {});
+    I k{ 0 };
+    for (auto& link : links) {
+      for (size_t key = 0; key < species; ++key) {
+        factors[key * m_links + k] = key < link.filters.size() ? inefficiency(link.filters[key]) : 1.0;
+      }
+      ++k;
+    }
+    for (size_t key = 0; key < species; ++key) {
+      for (k = 0; k < m_links; ++k) {
+        if (factors[key * m_links + k] < 0.0) {
+          blocked[key].push_back(k);
+        }
+      }
+    }
+    ++version;
+  }
+
+  // Recompute the factors for one link, call this after changing the link's filter controls or efficiencies
+  template <typename L> void update(I index, const L& link)
+  {
+    for (size_t key = 0; key < blocked.size(); ++key) {
+      double factor = key < link.filters.size() ? inefficiency(link.filters[key]) : 1.0;
+      double& current = factors[key * m_links + index];
+      if (factor == current) {
+        continue;
+      }
+      auto& list = blocked[key];
+      auto found = std::lower_bound(list.begin(), list.end(), index);
+      if (factor < 0.0 && current >= 0.0) {
+        list.insert(found, index);
+      } else if (factor >= 0.0 && current < 0.0) {
+        list.erase(found);
+      }
+      current = factor;
+      ++version;
+    }
+  }
+
+  // The factors for one species, in link order
+  const double* operator[](size_t key) const
+  {
+    return factors.data() + key * m_links;
+  }
+
+  size_t memory_usage() const
+  {
+    size_t bytes{ memory::bytes(factors) + memory::bytes(blocked) };
+    for (auto& list : blocked) {
+      bytes += memory::bytes(list);
+    }
+    return bytes;
+  }
+
+  std::vector<double> factors;
+  std::vector<std::vector<I>> blocked; // Indices of the links that block each species
+  std::uint64_t version{ 0 }; // Incremented whenever a factor changes
+
+private:
+  size_t m_links{ 0 };
+};
+
+// The value array location of a link's entry in a matrix set up with a pattern
+template <Flux E, typename O> auto location(const O& at)
+{
+  if constexpr (E == Flux::Diagonal0) {
+    return at.diagonal0;
+  } else if constexpr (E == Flux::Diagonal1) {
+    return at.diagonal1;
+  } else if constexpr (E == Flux::Lower) {
+    return at.lower;
+  } else {
+    return at.upper;
+  }
+}
+
+// Fill a matrix that was set up with a pattern using cached pass-through factors
+template <typename L, typename M, typename I> void matrix(size_t key, M& matrix, L& links, const Pattern<M>& pattern,
+  const PassThrough<I>& pass)
+{
+  double* values = matrix.valuePtr();
+  std::fill(values, values + matrix.nonZeros(), 0.0);
+  const double* factors = pass[key];
+  auto offset = pattern.offsets.begin();
+  for (auto& link : links) {
+    auto& at = *offset;
+    ++offset;
+    for_each_flux_with(link, *factors, [&](auto entry, double value) { values[location<decltype(entry)::value>(at)] += value; });
+    ++factors;
+  }
+}
+
+// Fill a matrix that was set up with a pattern, writing each entry directly into the value array
+template <typename L, typename M, typename K> void matrix(const K& key, M& matrix, L& links, const Pattern<M>& pattern)
+{
+  double* values = matrix.valuePtr();
+  std::fill(values, values + matrix.nonZeros(), 0.0);
+  auto offset = pattern.offsets.begin();
+  for (auto& link : links) {
+    auto& at = *offset;
+    ++offset;
+    for_each_flux(link, key, [&](auto entry, double value) { values[location<decltype(entry)::value>(at)] += value; });
+  }
+}
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_SPARSITY_HPP
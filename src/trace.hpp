@@ -0,0 +1,175 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef AIRFLOWNETWORK_TRACE_HPP
+#define AIRFLOWNETWORK_TRACE_HPP
+
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+#include <cmath>
+
+namespace airflownetwork {
+namespace trace {
+
+// A completed span in Chrome trace event terms, the names are expected to be string literals
+struct Event
+{
+  const char* name;
+  const char* category;
+  double start; // Microseconds since the recorder was created
+  double duration;
+  std::array<std::pair<const char*, double>, 4> args;
+  unsigned arg_count;
+};
+
+// Buffers trace events in memory, write them out once the run is over and load the file
+// in chrome://tracing or Perfetto
+class Recorder
+{
+public:
+  Recorder() : m_origin(std::chrono::steady_clock::now())
+  {}
+
+  double now() const
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+  }
+
+  void add(const Event& event)
+  {
+    m_events.push_back(event);
+  }
+
+  const std::vector<Event>& events() const
+  {
+    return m_events;
+  }
+
+  void clear()
+  {
+    m_events.clear();
+  }
+
+  void write_json(std::ostream& stream) const
+  {
+    // Timestamps are written in fixed notation so that long runs keep microsecond resolution
+    auto flags = stream.flags();
+    auto precision = stream.precision();
+    stream << "{\"traceEvents\":[";
+    bool first{ true };
+    for (auto& event : m_events) {
+      stream << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+        << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << std::fixed << std::setprecision(3) << event.start << ",\"dur\":"
+        << event.duration;
+      stream.flags(flags);
+      stream.precision(precision);
+      if (event.arg_count > 0) {
+        stream << ",\"args\":{";
+        for (unsigned i = 0; i < event.arg_count; ++i) {
+          stream << (i == 0 ? "" : ",") << '\"' << event.args[i].first << "\":";
+          write_value(stream, event.args[i].second);
+        }
+        stream << '}';
+      }
+      stream << '}';
+      first = false;
+    }
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+
+private:
+  // JSON has no NaN or infinity, so those are written as strings rather than producing an unreadable file
+  static void write_value(std::ostream& stream, double value)
+  {
+    if (std::isnan(value)) {
+      stream << "\"NaN\"";
+    } else if (std::isinf(value)) {
+      stream << (value > 0.0 ? "\"Infinity\"" : "\"-Infinity\"");
+    } else {
+      stream << value;
+    }
+  }
+
+  std::chrono::steady_clock::time_point m_origin;
+  std::vector<Event> m_events;
+};
+
+// Records a span from construction to destruction, does nothing if the recorder is null
+class Span
+{
+public:
+  Span(Recorder* recorder, const char* name, const char* category) : m_recorder(recorder)
+  {
+    if (m_recorder) {
+      m_event.name = name;
+      m_event.category = category;
+      m_event.start = m_recorder->now();
+      m_event.arg_count = 0;
+    }
+  }
+
+  ~Span()
+  {
+    if (m_recorder) {
+      m_event.duration = m_recorder->now() - m_event.start;
+      m_recorder->add(m_event);
+    }
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+  // Set an argument, up to four per span, setting the same name again replaces the value
+  void arg(const char* name, double value)
+  {
+    if (!m_recorder) {
+      return;
+    }
+    for (unsigned i = 0; i < m_event.arg_count; ++i) {
+      if (m_event.args[i].first == name) {
+        m_event.args[i].second = value;
+        return;
+      }
+    }
+    if (m_event.arg_count < m_event.args.size()) {
+      m_event.args[m_event.arg_count++] = { name, value };
+    }
+  }
+
+private:
+  Recorder* m_recorder;
+  Event m_event;
+};
+
+}
+}
+
+#endif // !AIRFLOWNETWORK_TRACE_HPP
@@ -59,67 +59,46 @@ struct HasCoeffRef <T, decltype((void)T::coeffRef, 0)> : std::true_type {};
 template <typename L, typename M, typename K> void matrix(const K& key, typename std::enable_if<HasCoeffRef<M>::value, M>::type& matrix, L& links)
 {
   for (auto& link : links) {
-    // Compute the inefficiency
-    double ineff = 1.0;
-    for (auto& filter : link.filters[key]) {
-      // Expect filters found via a key, get the combined efficiency with a schedule value
-      double eff = filter.efficiency * filter.control;
-      if (eff == 1.0) {
-        // Nothing is going to be transported
-        // link.active = false;
-        goto inactive;
+    auto i = link.node0.index;
+    auto j = link.node1.index;
+    for_each_flux(link, key, [&](auto entry, double value) {
+      switch (entry) {
+      case Flux::Diagonal0:
+        matrix.coeffRef(i, i) += value;
+        break;
+      case Flux::Diagonal1:
+        matrix.coeffRef(j, j) += value;
+        break;
+      case Flux::Lower:
+        matrix.coeffRef(j, i) += value;
+        break;
+      case Flux::Upper:
+        matrix.coeffRef(i, j) += value;
+        break;
       }
-      ineff *= (1.0 - eff);
-    }
-    if (link.nf == 1) {
-      if (link.flow > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node0.index) -= link.flow; // This is a diagonal entry
-        matrix.coeffRef(link.node1.index, link.node0.index) += link.flow * ineff;
-      } else if (link.flow < 0) {
-        matrix.coeffRef(link.node0.index, link.node1.index) -= link.flow * ineff;
-        matrix.coeffRef(link.node1.index, link.node1.index) += link.flow; // This is a diagonal entry
-      }
-    } else if (link.nf == 2) { // This is not tested yet
-      if (link.flow0 > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node0.index) -= link.flow0; // This is a diagonal entry
-        matrix.coeffRef(link.node1.index, link.node0.index) += link.flow0 * ineff;
-      }
-      if (link.flow1 > 0.0) {
-        matrix.coeffRef(link.node0.index, link.node1.index) += link.flow1 * ineff;
-        matrix.coeffRef(link.node1.index, link.node1.index) -= link.flow1; // This is a diagonal entry
-      }
-    }
-  inactive:;
+    });
   }
 }
 
 template <typename L, typename M, typename K> void matrix(const K& key, M& matrix, L& links)
 {
   for (auto& link : links) {
-    // Compute the inefficiency
-    double ineff = 1.0;
-    for (auto& filter : link.filters[key]) {
-      // Expect filters found via a key, get the combined efficiency with a schedule value
-      double eff = filter.efficiency * filter.control;
-      if (eff == 1.0) {
-        // Nothing is going to be transported
-        // link.active = false;
-        goto inactive;
-      }
-      ineff *= (1.0 - eff);
-    }
-    if (link.nf == 1) {
-      if (link.flow > 0.0) {
-        matrix(link.node0.index) -= link.flow; // This is a diagonal entry
-        matrix(link.index1) += link.flow * ineff;
-      } else if (link.flow < 0) {
-        matrix(link.index0) -= link.flow * ineff;
-        matrix(link.node1.index) += link.flow; // This is a diagonal entry
+    for_each_flux(link, key, [&](auto entry, double value) {
+      switch (entry) {
+      case Flux::Diagonal0:
+        matrix(link.node0.index) += value;
+        break;
+      case Flux::Diagonal1:
+        matrix(link.node1.index) += value;
+        break;
+      case Flux::Lower:
+        matrix(link.index1) += value;
+        break;
+      case Flux::Upper:
+        matrix(link.index0) += value;
+        break;
       }
-    } else if (link.nf == 2) {
-      // TODO!!!
-    }
-  inactive: ;
+    });
   }
 }
 
@@ -155,7 +155,8 @@ TEST_CASE("Test the original generic crack function", "[generic_crack0]")
 
 TEST_CASE("Test the power law element", "[PowerLaw]")
 {
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   airflownetwork::State<airflownetwork::properties::Fixed> state0;
   airflownetwork::State<airflownetwork::properties::Fixed> state1;
 
@@ -213,7 +214,8 @@ TEST_CASE("Test the power law element", "[PowerLaw]")
 
 TEST_CASE("Test the simple opening element", "[SimpleOpening]")
 {
-  airflownetwork::SimpleOpening<airflownetwork::properties::Fixed> opening("opening", 1.0, 0.5, 0.01, 0.5, 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::SimpleOpening<airflownetwork::properties::Fixed> opening(names.intern("opening"), 1.0, 0.5, 0.01, 0.5, 0.001, 0.001);
 
   airflownetwork::State<airflownetwork::properties::Fixed> state0;
   airflownetwork::State<airflownetwork::properties::Fixed> state1;
@@ -0,0 +1,195 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#define CATCH_CONFIG_MAIN
+// Eigen allocates with malloc, so have it assert on any heap allocation while that is switched off
+#define EIGEN_RUNTIME_NO_MALLOC
+#include "catch.hpp"
+#include "model.hpp"
+#include "generator.hpp"
+#include "sparsity.hpp"
+#include "stepper.hpp"
+#include "Eigen/SparseCore"
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <memory>
+
+// Count every allocation made through the global operator new, and the bytes that are still live.
+// Each block carries its size in a header so that the sizes can be taken back off when it is freed.
+// This replaces the operator for the whole executable, which is why these tests are kept out of the
+// main test program.
+static size_t allocations{ 0 };
+static size_t live_bytes{ 0 };
+static const size_t header{ alignof(std::max_align_t) };
+
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  if (void* block = std::malloc(header + size)) {
+    *static_cast<std::size_t*>(block) = size;
+    live_bytes += size;
+    return static_cast<char*>(block) + header;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  if (pointer) {
+    void* block = static_cast<char*>(pointer) - header;
+    live_bytes -= *static_cast<std::size_t*>(block);
+    std::free(block);
+  }
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+  operator delete(pointer);
+}
+
+TEST_CASE("Test allocation-free steady solve", "[allocation]")
+{
+  size_t start{ allocations };
+  auto probe = std::make_unique<double>(1.0);
+  REQUIRE(allocations == start + 1);
+
+  airflownetwork::generator::Building building;
+  building.stories = 5;
+  building.zones_per_story = 6;
+  auto network = airflownetwork::generator::generate(building);
+  airflownetwork::Model<size_t, airflownetwork::properties::AIRNET> model("allocation");
+  REQUIRE(network.build(model));
+  model.verbose = false;
+  // Tight enough that the change to a link below takes more than the residual check to resolve
+  model.tolerance = 1.0e-10;
+
+  size_t before{ allocations };
+  bool converged{ true };
+  for (int i = 0; i < 10; ++i) {
+    for (auto& node : model.simulated_nodes) {
+      node.pressure = airflownetwork::properties::AIRNET::pressure_0;
+    }
+    converged &= model.steady_solve();
+  }
+  size_t count{ allocations - before };
+  CHECK(converged);
+  CHECK(count == 0);
+
+  // Links changed between solves are picked up without allocating
+  model.links[0].control = 0.5;
+  before = allocations;
+  model.steady_solve();
+  count = allocations - before;
+  CHECK(count == 0);
+  CHECK(model.history.iterations.size() > 1);
+}
+
+TEST_CASE("Test allocation-free transport steps", "[allocation]")
+{
+  airflownetwork::generator::Building building;
+  building.stories = 5;
+  building.zones_per_story = 6;
+  auto network = airflownetwork::generator::generate(building);
+  airflownetwork::Model<size_t, airflownetwork::properties::AIRNET> model("allocation");
+  REQUIRE(network.build(model));
+  model.verbose = false;
+  REQUIRE(model.steady_solve());
+  Eigen::Index n{ static_cast<Eigen::Index>(model.node_count()) };
+  for (auto& link : model.links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  }
+
+  typedef Eigen::SparseMatrix<double> Matrix;
+  Matrix base;
+  airflownetwork::transport::Pattern<Matrix> pattern(n, model.links, base);
+  airflownetwork::transport::matrix(0, base, model.links, pattern);
+  airflownetwork::transport::Stepper<Matrix, Eigen::VectorXd, airflownetwork::transport::ProfileSolver<Matrix, Eigen::VectorXd>> stepper(base);
+  Eigen::VectorXd G = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd R = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd A = Eigen::VectorXd::Ones(n);
+  Eigen::VectorXd C = Eigen::VectorXd::Zero(n);
+  C(0) = 1.0;
+
+  // Reusing the factorization, refactoring for a new timestep, and refactoring for new flows
+  size_t before{ allocations };
+  Eigen::internal::set_is_malloc_allowed(false);
+  bool stepped{ true };
+  for (int i = 0; i < 10; ++i) {
+    G.setZero();
+    stepped &= stepper.implicit_euler(60.0, G, R, A, C);
+  }
+  G.setZero();
+  stepped &= stepper.implicit_euler(30.0, G, R, A, C);
+  airflownetwork::transport::matrix(0, stepper.base(), model.links, pattern);
+  stepper.set_version(1, 0);
+  G.setZero();
+  stepped &= stepper.implicit_euler(30.0, G, R, A, C);
+  Eigen::internal::set_is_malloc_allowed(true);
+  size_t count{ allocations - before };
+  CHECK(stepped);
+  CHECK(count == 0);
+  CHECK(stepper.factorizations() == 3);
+  CHECK(C.allFinite());
+}
+
+TEST_CASE("Test memory usage against the heap", "[allocation]")
+{
+  airflownetwork::generator::Building building;
+  building.stories = 10;
+  building.zones_per_story = 10;
+  auto network = airflownetwork::generator::generate(building);
+
+  size_t before{ live_bytes };
+  {
+    airflownetwork::Model<size_t, airflownetwork::properties::AIRNET> model("heap");
+    REQUIRE(network.build(model));
+    for (auto& node : model.simulated_nodes) {
+      node.concentrations = { 0.0, 0.0 };
+    }
+    size_t held{ live_bytes - before };
+    // The hash maps and the skyline are estimates, so the report only has to be close to what is on the heap
+    size_t reported{ model.memory_usage().total() };
+    CHECK(reported > 0.9 * held);
+    CHECK(reported < 1.1 * held);
+  }
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "catch.hpp"
+#include "airflownetwork.h"
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+
+static const char* chain{ R"xml(<?xml version="1.0" encoding="utf-8"?>
+<AirflowNetwork>
+  <Elements>
+    <PowerLaw ID="Crack"><Coefficient>1.0e-5</Coefficient><Exponent>0.65</Exponent></PowerLaw>
+  </Elements>
+  <Nodes>
+    <Node ID="outside"><PressureHandling>Fixed</PressureHandling><DefaultState><Pressure units="Pa">101525.0</Pressure></DefaultState></Node>
+    <Node ID="zone1"/>
+    <Node ID="zone2"/>
+    <Node ID="exhaust"><PressureHandling>Fixed</PressureHandling><DefaultState><Pressure units="Pa">101325.0</Pressure></DefaultState></Node>
+  </Nodes>
+  <Links>
+    <Link ID="in"><ElementID IDref="Crack"/><Nodes><Node><NodeID IDref="outside"/></Node><Node><NodeID IDref="zone1"/></Node></Nodes></Link>
+    <Link ID="middle"><ElementID IDref="Crack"/><Nodes><Node><NodeID IDref="zone1"/></Node><Node><NodeID IDref="zone2"/></Node></Nodes></Link>
+    <Link ID="out"><ElementID IDref="Crack"/><Nodes><Node><NodeID IDref="zone2"/></Node><Node><NodeID IDref="exhaust"/></Node></Nodes></Link>
+  </Links>
+</AirflowNetwork>
+)xml" };
+
+TEST_CASE("Test the C interface", "[c_api]")
+{
+  afn_model* xml = afn_create_from_xml_string(chain);
+  REQUIRE(xml != nullptr);
+  CHECK(afn_set_tolerance(xml, 1.0e-12, 50) == AFN_OK);
+  CHECK(afn_node_count(xml) == 4);
+  CHECK(afn_link_count(xml) == 3);
+  CHECK(afn_solve(xml) == AFN_OK);
+  std::vector<double> pressures(4), flows(3);
+  REQUIRE(afn_get_pressures(xml, pressures.data(), pressures.size()) == AFN_OK);
+  REQUIRE(afn_get_flows(xml, flows.data(), flows.size()) == AFN_OK);
+  // Three identical cracks in series split the pressure difference evenly
+  CHECK(pressures[1] == Approx(101525.0 - 200.0 / 3.0).epsilon(1.0e-6));
+  CHECK(pressures[2] == Approx(101325.0 + 200.0 / 3.0).epsilon(1.0e-6));
+  size_t zone2, out, node0, node1;
+  REQUIRE(afn_find_node(xml, "zone2", &zone2) == AFN_OK);
+  CHECK(zone2 == 2);
+  CHECK(afn_find_node(xml, "nowhere", &zone2) == AFN_BAD_ARGUMENT);
+  CHECK(std::string(afn_last_error()).find("nowhere") != std::string::npos);
+  REQUIRE(afn_find_link(xml, "out", &out) == AFN_OK);
+  REQUIRE(afn_link_nodes(xml, out, &node0, &node1) == AFN_OK);
+  CHECK(node0 == 2);
+  CHECK(node1 == 3);
+
+  // The same network from arrays, with the boundary changed through the interface
+  const char* names[]{ "outside", "zone1", "zone2", "exhaust" };
+  int types[]{ AFN_FIXED, AFN_SIMULATED, AFN_SIMULATED, AFN_FIXED };
+  double initial[]{ 101325.0, 101325.0, 101325.0, 101325.0 };
+  double coefficient[]{ 1.0e-5 };
+  double exponent[]{ 0.65 };
+  size_t node0s[]{ 0, 1, 2 };
+  size_t node1s[]{ 1, 2, 3 };
+  size_t elements[]{ 0, 0, 0 };
+  afn_model* arrays = afn_create(4, names, types, nullptr, initial, nullptr, 1, nullptr, coefficient, exponent, 3, nullptr, node0s,
+    node1s, elements);
+  REQUIRE(arrays != nullptr);
+  CHECK(afn_set_tolerance(arrays, 1.0e-12, 50) == AFN_OK);
+  size_t outside{ 0 };
+  double boundary{ 101525.0 };
+  REQUIRE(afn_set_node_pressures(arrays, 1, &outside, &boundary) == AFN_OK);
+  CHECK(afn_solve(arrays) == AFN_OK);
+  std::vector<double> array_flows(3);
+  REQUIRE(afn_get_flows(arrays, array_flows.data(), array_flows.size()) == AFN_OK);
+  for (size_t i = 0; i < 3; ++i) {
+    CHECK(array_flows[i] == Approx(flows[i]));
+    CHECK(std::abs(flows[i]) == Approx(std::abs(flows[0])));
+  }
+
+  // Closing the middle link stops the flow
+  CHECK(afn_set_link_control(arrays, 1, 0.0) == AFN_OK);
+  afn_solve(arrays);
+  REQUIRE(afn_get_flows(arrays, array_flows.data(), array_flows.size()) == AFN_OK);
+  CHECK(array_flows[1] == 0.0);
+  CHECK(afn_set_link_control(arrays, 3, 0.0) == AFN_BAD_ARGUMENT);
+  CHECK(afn_get_flows(arrays, array_flows.data(), 2) == AFN_BAD_ARGUMENT);
+
+  int bad_types[]{ AFN_FIXED, 7, AFN_SIMULATED, AFN_FIXED };
+  CHECK(afn_create(4, names, bad_types, nullptr, nullptr, nullptr, 1, nullptr, coefficient, exponent, 3, nullptr, node0s, node1s,
+    elements) == nullptr);
+  CHECK(afn_create_from_xml_string("<Nothing/>") == nullptr);
+
+  afn_destroy(xml);
+  afn_destroy(arrays);
+}
+
+TEST_CASE("Test the C interface views and batch solve", "[c_api]")
+{
+  afn_model* model = afn_create_from_xml_string(chain);
+  REQUIRE(model != nullptr);
+  CHECK(afn_set_tolerance(model, 1.0e-12, 50) == AFN_OK);
+  const double* p = afn_pressure_data(model);
+  const double* flow = afn_flow_data(model);
+  REQUIRE(p != nullptr);
+  REQUIRE(flow != nullptr);
+  // A new iteration limit only resizes the convergence history, so the views stay put
+  CHECK(afn_set_tolerance(model, 1.0e-12, 100) == AFN_OK);
+  CHECK(afn_pressure_data(model) == p);
+  CHECK(afn_flow_data(model) == flow);
+  CHECK(afn_solve(model) == AFN_OK);
+  // The views follow the solver without copying
+  std::vector<size_t> indices(4);
+  std::vector<double> pressures(4), flows(3);
+  REQUIRE(afn_node_indices(model, indices.data(), indices.size()) == AFN_OK);
+  REQUIRE(afn_get_pressures(model, pressures.data(), pressures.size()) == AFN_OK);
+  REQUIRE(afn_get_flows(model, flows.data(), flows.size()) == AFN_OK);
+  for (size_t i = 0; i < 4; ++i) {
+    CHECK(p[indices[i]] == pressures[i]);
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    CHECK(flow[i] == flows[i]);
+  }
+  CHECK(afn_node_indices(model, indices.data(), 2) == AFN_BAD_ARGUMENT);
+
+  size_t count{ 1 };
+  CHECK(afn_concentration_data(model, 1, &count) == nullptr);
+  CHECK(count == 0);
+  REQUIRE(afn_set_species_count(model, 2) == AFN_OK);
+  double* c = afn_concentration_data(model, 1, &count);
+  REQUIRE(c != nullptr);
+  CHECK(count == 2);
+  c[1] = 0.5;
+  CHECK(afn_concentration_data(model, 1, nullptr)[1] == 0.5);
+  CHECK(afn_concentration_data(model, 4, &count) == nullptr);
+  // Exceptions are caught at the interface and reported like any other failure
+  CHECK(afn_set_species_count(model, SIZE_MAX) == AFN_ERROR);
+  CHECK(std::string(afn_last_error()).size() > 0);
+  CHECK(afn_concentration_data(model, 1, nullptr)[1] == 0.5);
+
+  // Each case moves the outside pressure, the last closes the middle link
+  size_t outside{ 0 };
+  double boundary[]{ 101525.0, 101425.0, 101525.0 };
+  std::vector<double> controls(9, 1.0);
+  controls[7] = 0.0;
+  std::vector<double> batch_pressures(12), batch_flows(9);
+  int status[3]{ -1, -1, -1 };
+  CHECK(afn_solve_batch(model, 3, 1, &outside, boundary, controls.data(), batch_pressures.data(), batch_flows.data(), status)
+    == AFN_OK);
+  for (size_t i = 0; i < 3; ++i) {
+    CHECK(status[i] == AFN_OK);
+    CHECK(batch_flows[i] == Approx(flows[i]));
+  }
+  CHECK(batch_flows[7] == 0.0);
+  CHECK(batch_pressures[4] == Approx(101425.0));
+  CHECK(batch_pressures[5] == Approx(101425.0 - 100.0 / 3.0).epsilon(1.0e-6));
+  CHECK(std::abs(batch_flows[3]) < std::abs(flows[0]));
+  // The views see the last case
+  CHECK(flow[1] == 0.0);
+  CHECK(afn_solve_batch(model, 1, 1, nullptr, boundary, nullptr, nullptr, nullptr, nullptr) == AFN_BAD_ARGUMENT);
+
+  afn_destroy(model);
+}
@@ -31,15 +31,19 @@
 #include "properties.hpp"
 #include "powerlaw.hpp"
 #include "eigen_transport.hpp"
+#include "stepper.hpp"
+#include "exponential.hpp"
 #include "Eigen/Sparse"
+#include <array>
 
 TEST_CASE("Test a very simple network, explicit, Eigen", "[eigen_transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -88,11 +92,12 @@ TEST_CASE("Test a very simple network, explicit, Eigen", "[eigen_transport]")
 
 TEST_CASE("Test a very simple network, opposite direction, explicit, eigen", "[eigen_transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -140,11 +145,12 @@ TEST_CASE("Test a very simple network, opposite direction, explicit, eigen", "[e
 
 TEST_CASE("Test a very simple network with zero, explicit, Eigen", "[eigen_transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -192,11 +198,12 @@ TEST_CASE("Test a very simple network with zero, explicit, Eigen", "[eigen_trans
 
 TEST_CASE("Test a very simple network, implicit, Eigen", "[eigen_transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -248,11 +255,12 @@ TEST_CASE("Test a very simple network, implicit, Eigen", "[eigen_transport]")
 
 TEST_CASE("Test a very simple network, Crank-Nicolson, Eigen", "[eigen_transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -302,3 +310,731 @@ TEST_CASE("Test a very simple network, Crank-Nicolson, Eigen", "[eigen_transport
   CHECK(0.5 * (c0(0) - c(0)) == Approx(c(1) - c0(1)));
 }
 
+
+TEST_CASE("Test a precomputed matrix pattern, Eigen", "[eigen_transport]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node2(names.intern("Node2"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link0"), node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link1"), node1, node2, powerlaw);
+  links.emplace_back(names.intern("Link2"), node0, node2, powerlaw);
+
+  airflownetwork::Filter filter(0.5);
+  for (auto& link : links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  }
+  links[1].filters[0].push_back(filter);
+  links[0].flow = 1.0;
+  links[1].flow = -2.0;
+  links[2].nf = 2;
+  links[2].flow0 = 0.5;
+  links[2].flow1 = 0.25;
+
+  // Set up the indices
+  node0.index = 0;
+  node1.index = 1;
+  node2.index = 2;
+
+  Eigen::SparseMatrix<double> matrix;
+  airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>> pattern(3, links, matrix);
+  CHECK(matrix.nonZeros() == 9);
+  CHECK(pattern.offsets.size() == 3);
+  const double* values = matrix.valuePtr();
+
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+
+  // Compare with the searching version
+  Eigen::SparseMatrix<double> reference(3, 3);
+  airflownetwork::transport::matrix<std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>>,
+    Eigen::SparseMatrix<double>, size_t>(0, reference, links);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      CHECK(matrix.coeff(i, j) == reference.coeff(i, j));
+    }
+  }
+  CHECK(matrix.coeff(0, 0) == -1.5);
+  CHECK(matrix.coeff(1, 2) == 1.0);
+
+  // Reversing the flows refills the same storage
+  for (auto& link : links) {
+    link.flow = -link.flow;
+  }
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+  CHECK(matrix.valuePtr() == values);
+  CHECK(matrix.nonZeros() == 9);
+  CHECK(matrix.coeff(0, 0) == -0.5);
+  CHECK(matrix.coeff(1, 1) == -3.0);
+  CHECK(matrix.coeff(0, 1) == 1.0);
+  CHECK(matrix.coeff(2, 1) == 1.0);
+  CHECK(matrix.coeff(1, 2) == 0.0);
+}
+
+TEST_CASE("Test multiple species with one factorization, Eigen", "[eigen_transport]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
+  links[0].flow = 1.0;
+  node0.index = 0;
+  node1.index = 1;
+
+  // Species 0 and 2 see the same filter, species 1 is unfiltered
+  links[0].filters = std::vector<std::vector<airflownetwork::Filter>>(3);
+  links[0].filters[0].emplace_back(0.5);
+  links[0].filters[2].emplace_back(0.5);
+  auto groups = airflownetwork::transport::group_species(std::vector<size_t>{ 0, 1, 2 }, links);
+  REQUIRE(groups.size() == 2);
+  CHECK(groups[0] == std::vector<size_t>{ 0, 2 });
+  CHECK(groups[1] == std::vector<size_t>{ 1 });
+
+  Eigen::VectorXd r(2);
+  r << 0.0, 0.1;
+  Eigen::VectorXd a0(2);
+  a0 << 1.0, 2.0;
+  Eigen::VectorXd a(2);
+  a << 1.0, 2.0;
+  Eigen::MatrixXd g(2, 2);
+  g << 0.0, 0.1,
+       0.2, 0.0;
+  Eigen::MatrixXd c(2, 2);
+  c << 0.5, 0.2,
+       0.5, 0.8;
+
+  Eigen::SparseMatrix<double> matrix;
+  airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>> pattern(2, links, matrix);
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+  Eigen::MatrixXd g0 = g;
+  Eigen::MatrixXd block = c;
+  airflownetwork::transport::crank_nicolson_block(solver, 0.25, matrix, g0, g, r, r, a0, a, block);
+
+  // Each column should match a single species solve
+  for (int k = 0; k < 2; ++k) {
+    airflownetwork::transport::matrix(0, matrix, links, pattern);
+    Eigen::VectorXd gk0 = g0.col(k);
+    Eigen::VectorXd gk = g0.col(k);
+    Eigen::VectorXd ck = c.col(k);
+    airflownetwork::transport::crank_nicolson(solver, 0.25, matrix, gk0, gk, r, r, a0, a, ck);
+    CHECK(block(0, k) == Approx(ck(0)));
+    CHECK(block(1, k) == Approx(ck(1)));
+  }
+
+  // Same again for implicit Euler
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+  g = g0;
+  block = c;
+  airflownetwork::transport::implicit_euler_block(solver, 0.25, matrix, g, r, a, block);
+  for (int k = 0; k < 2; ++k) {
+    airflownetwork::transport::matrix(0, matrix, links, pattern);
+    Eigen::VectorXd gk = g0.col(k);
+    Eigen::VectorXd ck = c.col(k);
+    airflownetwork::transport::implicit_euler(solver, 0.25, matrix, gk, r, a, a, ck);
+    CHECK(block(0, k) == Approx(ck(0)));
+    CHECK(block(1, k) == Approx(ck(1)));
+  }
+
+  // A key past the end of the filter lists groups with the unfiltered species
+  groups = airflownetwork::transport::group_species(std::vector<size_t>{ 1, 5 }, links);
+  REQUIRE(groups.size() == 1);
+  CHECK(groups[0] == std::vector<size_t>{ 1, 5 });
+}
+
+TEST_CASE("Test factorization reuse in the transport stepper, Eigen", "[eigen_transport]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
+  links[0].filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  links[0].filters[0].emplace_back(0.5);
+  links[0].flow = 1.0;
+  node0.index = 0;
+  node1.index = 1;
+
+  Eigen::SparseMatrix<double> matrix;
+  airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>> pattern(2, links, matrix);
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+
+  Eigen::VectorXd r(2);
+  r << 0.0, 0.0;
+  Eigen::VectorXd a(2);
+  a << 1.0, 1.0;
+  Eigen::VectorXd c(2);
+  c << 0.5, 0.5;
+  Eigen::VectorXd g(2);
+
+  airflownetwork::transport::Stepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>> stepper(matrix);
+  airflownetwork::instrumentation::Statistics statistics;
+  stepper.statistics = &statistics;
+  Eigen::VectorXd reference = c;
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+  for (int i = 0; i < 3; ++i) {
+    g << 0.0, 0.0;
+    REQUIRE(stepper.implicit_euler(0.25, g, r, a, c));
+    auto copy = matrix;
+    g << 0.0, 0.0;
+    airflownetwork::transport::implicit_euler(solver, 0.25, copy, g, r, a, a, reference);
+    CHECK(c(0) == Approx(reference(0)));
+    CHECK(c(1) == Approx(reference(1)));
+  }
+  CHECK(stepper.factorizations() == 1);
+  // Transport time stays out of the airflow phases
+  using airflownetwork::instrumentation::Phase;
+  CHECK(statistics[Phase::Factorization].count == 0);
+  if constexpr (airflownetwork::instrumentation::enabled) {
+    CHECK(statistics[Phase::Transport].count == 3);
+    CHECK(statistics[Phase::TransportFactorization].count == 1);
+    CHECK(statistics[Phase::TransportSolve].count == 3);
+  }
+
+  // New flows require a new factorization
+  links[0].flow = 2.0;
+  airflownetwork::transport::matrix(0, stepper.base(), links, pattern);
+  stepper.set_version(1, 0);
+  g << 0.0, 0.0;
+  REQUIRE(stepper.implicit_euler(0.25, g, r, a, c));
+  CHECK(stepper.factorizations() == 2);
+
+  // So does a different timestep
+  g << 0.0, 0.0;
+  REQUIRE(stepper.implicit_euler(0.5, g, r, a, c));
+  CHECK(stepper.factorizations() == 3);
+  g << 0.0, 0.0;
+  REQUIRE(stepper.implicit_euler(0.5, g, r, a, c));
+  CHECK(stepper.factorizations() == 3);
+
+  // And a filter change, which shows up in the pass-through version but not in the flows
+  airflownetwork::transport::PassThrough<size_t> pass(links, 1);
+  auto filter_version = pass.version;
+  links[0].filters[0][0].control = 0.0;
+  pass.update(0, links[0]);
+  REQUIRE(pass.version != filter_version);
+  airflownetwork::transport::matrix(0, stepper.base(), links, pattern, pass);
+  stepper.set_version(1, pass.version);
+  g << 0.0, 0.0;
+  REQUIRE(stepper.implicit_euler(0.5, g, r, a, c));
+  CHECK(stepper.factorizations() == 4);
+  g << 0.0, 0.0;
+  REQUIRE(stepper.implicit_euler(0.5, g, r, a, c));
+  CHECK(stepper.factorizations() == 4);
+}
+
+TEST_CASE("Test Crank-Nicolson in the transport stepper, Eigen", "[eigen_transport]")
+{
+  // The base matrix only has the entries for the flow, the stepper adds the rest of the diagonal
+  Eigen::SparseMatrix<double> matrix(2, 2);
+  matrix.insert(0, 0) = -1.0;
+  matrix.insert(1, 0) = 0.5;
+  matrix.makeCompressed();
+
+  Eigen::VectorXd r(2);
+  r << 0.0, 0.1;
+  Eigen::VectorXd a(2);
+  a << 1.0, 2.0;
+  Eigen::VectorXd g0(2);
+  Eigen::VectorXd g(2);
+  Eigen::VectorXd c(2);
+  c << 0.5, 0.5;
+
+  airflownetwork::transport::Stepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>> stepper(matrix);
+  Eigen::VectorXd reference = c;
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+  const double* values{ nullptr };
+  for (int i = 0; i < 2; ++i) {
+    g0 << 0.1, 0.0;
+    g << 0.1, 0.0;
+    REQUIRE(stepper.crank_nicolson(0.25, g0, g, r, r, a, a, c));
+    if (i == 0) {
+      values = stepper.system().valuePtr();
+    }
+    Eigen::SparseMatrix<double> copy = matrix;
+    copy.insert(1, 1) = 0.0;
+    g << 0.1, 0.0;
+    airflownetwork::transport::crank_nicolson(solver, 0.25, copy, g0, g, r, r, a, a, reference);
+    CHECK(c(0) == Approx(reference(0)));
+    CHECK(c(1) == Approx(reference(1)));
+  }
+  CHECK(stepper.factorizations() == 1);
+  CHECK(stepper.system().valuePtr() == values);
+  CHECK(stepper.system().nonZeros() == 3);
+  CHECK(stepper.base().coeff(0, 0) == -1.0);
+  CHECK(stepper.base().coeff(1, 0) == 0.5);
+
+  // A new structure with the same number of entries is noticed and laid out again
+  Eigen::SparseMatrix<double> swapped(2, 2);
+  swapped.insert(0, 0) = -1.0;
+  swapped.insert(0, 1) = 0.5;
+  swapped.makeCompressed();
+  stepper.base() = swapped;
+  stepper.set_version(1, 0);
+  c << 0.5, 0.5;
+  reference = c;
+  g << 0.1, 0.0;
+  REQUIRE(stepper.implicit_euler(0.25, g, r, a, c));
+  Eigen::SparseMatrix<double> copy = swapped;
+  copy.insert(1, 1) = 0.0;
+  g << 0.1, 0.0;
+  airflownetwork::transport::implicit_euler(solver, 0.25, copy, g, r, a, a, reference);
+  CHECK(c(0) == Approx(reference(0)));
+  CHECK(c(1) == Approx(reference(1)));
+}
+
+TEST_CASE("Test the profile solver in the transport stepper, Eigen", "[eigen_transport]")
+{
+  // A ring has an entry in the far corner, which fills in the whole profile
+  int n{ 10 };
+  Eigen::SparseMatrix<double> ring(n, n);
+  for (int i = 0; i < n; ++i) {
+    ring.insert(i, i) = -1.0;
+    ring.insert((i + 1) % n, i) = 1.0;
+  }
+  ring.makeCompressed();
+  Eigen::VectorXd r = Eigen::VectorXd::Constant(n, 1.0e-3);
+  Eigen::VectorXd a = Eigen::VectorXd::LinSpaced(n, 1.0, 10.0);
+  Eigen::VectorXd g = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd c = Eigen::VectorXd::Zero(n);
+  c(0) = 1.0;
+  Eigen::VectorXd reference = c;
+
+  airflownetwork::transport::Stepper<Eigen::SparseMatrix<double>, Eigen::VectorXd,
+    airflownetwork::transport::ProfileSolver<Eigen::SparseMatrix<double>, Eigen::VectorXd>> stepper(ring);
+  airflownetwork::transport::Stepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>> lu(ring);
+  for (int i = 0; i < 3; ++i) {
+    g.setZero();
+    REQUIRE(stepper.implicit_euler(0.5, g, r, a, c));
+    g.setZero();
+    REQUIRE(lu.implicit_euler(0.5, g, r, a, reference));
+    for (int j = 0; j < n; ++j) {
+      CHECK(c(j) == Approx(reference(j)));
+    }
+  }
+  CHECK(stepper.factorizations() == 1);
+
+  // A zero pivot is reported as a failed factorization
+  a.setZero();
+  r.setZero();
+  Eigen::SparseMatrix<double> zero(n, n);
+  zero.insert(1, 0) = 0.0;
+  zero.makeCompressed();
+  airflownetwork::transport::Stepper<Eigen::SparseMatrix<double>, Eigen::VectorXd,
+    airflownetwork::transport::ProfileSolver<Eigen::SparseMatrix<double>, Eigen::VectorXd>> singular(zero);
+  CHECK_FALSE(singular.implicit_euler(0.5, g, r, a, c));
+}
+
+TEST_CASE("Test adaptive timestep control, Eigen", "[eigen_transport]")
+{
+  // One zone with first order removal and no flow
+  Eigen::SparseMatrix<double> matrix(1, 1);
+  Eigen::VectorXd r(1);
+  r << 1.0e-3;
+  Eigen::VectorXd a(1);
+  a << 1.0;
+  Eigen::VectorXd g(1);
+  g << 0.0;
+  Eigen::VectorXd c(1);
+  c << 1.0;
+
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    stepper(matrix, 1.0, 3600.0);
+  REQUIRE(stepper.advance(3600.0, g, r, a, c));
+  CHECK(c(0) == Approx(std::exp(-3.6)).epsilon(1.0e-3));
+  CHECK(stepper.steps() < 360);
+  CHECK(stepper.step() > 1.0);
+
+  // A source pulse, the interval ends exactly at the change point
+  g << 1.0e-3;
+  REQUIRE(stepper.advance(60.0, g, r, a, c));
+  g << 0.0;
+  REQUIRE(stepper.advance(3600.0, g, r, a, c));
+  double expected = std::exp(-3.6) * std::exp(-3.66) + (1.0 - std::exp(-0.06)) * std::exp(-3.6);
+  CHECK(c(0) == Approx(expected).epsilon(1.0e-3));
+
+  // The first step comes from an error estimate, not from the smallest step allowed
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    fresh(matrix, 1.0e-3, 3600.0);
+  c << 1.0;
+  REQUIRE(fresh.advance(60.0, g, r, a, c));
+  CHECK(fresh.steps() <= 3);
+  CHECK(fresh.rejections() == 0);
+  CHECK(c(0) == Approx(std::exp(-0.06)).epsilon(1.0e-3));
+
+  // Step limits that can't work are refused rather than looping
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    zero(matrix, 0.0, 60.0);
+  CHECK_FALSE(zero.advance(60.0, g, r, a, c));
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    inverted(matrix, 60.0, 1.0);
+  CHECK_FALSE(inverted.advance(60.0, g, r, a, c));
+  CHECK(zero.steps() + inverted.steps() == 0);
+
+  // An interval that isn't a multiple of the step is split evenly rather than ending with a short step,
+  // so repeating it reuses the factorizations
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    capped(matrix, 1.0, 60.0);
+  c << 1.0;
+  REQUIRE(capped.advance(3600.0, g, r, a, c));
+  REQUIRE(capped.advance(90.0, g, r, a, c));
+  auto factorizations = capped.factorizations();
+  auto steps = capped.steps();
+  REQUIRE(capped.advance(90.0, g, r, a, c));
+  auto per_interval = capped.steps() - steps;
+  CHECK(per_interval > 1);
+  REQUIRE(capped.advance(90.0, g, r, a, c));
+  CHECK(capped.factorizations() == factorizations);
+  CHECK(capped.steps() == steps + 2 * per_interval);
+
+  // An interval that is a whole number of steps takes exactly that many, rounding notwithstanding
+  airflownetwork::transport::AdaptiveStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    fixed(matrix, 0.1, 0.1);
+  c << 1.0;
+  REQUIRE(fixed.advance(0.3, g, r, a, c));
+  CHECK(fixed.steps() == 3);
+  CHECK(fixed.factorizations() == 2);
+}
+
+TEST_CASE("Test sub-cycled explicit transport, Eigen", "[eigen_transport]")
+{
+  // A small zone that flushes into a large one
+  Eigen::SparseMatrix<double> matrix(2, 2);
+  matrix.insert(0, 0) = -1.0;
+  matrix.insert(1, 0) = 1.0;
+  matrix.insert(1, 1) = 0.0;
+  matrix.makeCompressed();
+  Eigen::VectorXd r(2);
+  r << 0.0, 0.0;
+  Eigen::VectorXd a(2);
+  a << 1.0, 100.0;
+  Eigen::VectorXd g(2);
+  g << 0.0, 0.0;
+  Eigen::VectorXd c(2);
+  c << 1.0, 0.0;
+
+  airflownetwork::transport::SubcycledStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    stepper(matrix);
+  CHECK(stepper.stable_step(r, a) == 1.0);
+
+  // A short step is done explicitly in a few substeps and stays bounded
+  REQUIRE(stepper.step(2.0, g, r, a, c));
+  CHECK(stepper.method() == decltype(stepper)::Method::Explicit);
+  CHECK(stepper.substeps() == 3);
+  CHECK(c(0) >= 0.0);
+  CHECK(c(0) < 1.0);
+  CHECK(c(0) + 100.0 * c(1) == Approx(1.0));
+
+  // A long step goes implicit
+  REQUIRE(stepper.step(1000.0, g, r, a, c));
+  CHECK(stepper.method() == decltype(stepper)::Method::Implicit);
+  CHECK(c(0) >= 0.0);
+  CHECK(c(0) + 100.0 * c(1) == Approx(1.0));
+
+  // A source is left alone by both methods
+  g << 1.0e-3, 0.0;
+  Eigen::VectorXd before = c;
+  REQUIRE(stepper.step(2.0, g, r, a, c));
+  CHECK(stepper.method() == decltype(stepper)::Method::Explicit);
+  CHECK(g(0) == 1.0e-3);
+  CHECK(c(0) + 100.0 * c(1) == Approx(before(0) + 100.0 * before(1) + 2.0e-3));
+  before = c;
+  REQUIRE(stepper.step(1000.0, g, r, a, c));
+  CHECK(stepper.method() == decltype(stepper)::Method::Implicit);
+  CHECK(g(0) == 1.0e-3);
+  CHECK(g(1) == 0.0);
+  CHECK(c(0) + 100.0 * c(1) == Approx(before(0) + 100.0 * before(1) + 1.0));
+
+  // Without capacity there is no stable explicit step, so even a short step goes implicit
+  a << 0.0, 100.0;
+  CHECK(stepper.stable_step(r, a) == 0.0);
+  REQUIRE(stepper.step(2.0, g, r, a, c));
+  CHECK(stepper.method() == decltype(stepper)::Method::Implicit);
+  CHECK(stepper.substeps() == 1);
+  CHECK(c(0) == Approx(1.0e-3));
+}
+
+TEST_CASE("Test the exponential integrator, Eigen", "[eigen_transport]")
+{
+  // Three zones in a loop with a filter and a source
+  Eigen::SparseMatrix<double> matrix(3, 3);
+  matrix.insert(0, 0) = -1.0;
+  matrix.insert(1, 0) = 0.5;
+  matrix.insert(1, 1) = -1.0;
+  matrix.insert(2, 1) = 1.0;
+  matrix.insert(2, 2) = -1.0;
+  matrix.insert(0, 2) = 1.0;
+  matrix.makeCompressed();
+  Eigen::VectorXd r(3);
+  r << 0.0, 0.01, 0.0;
+  Eigen::VectorXd a(3);
+  a << 10.0, 50.0, 2.0;
+  Eigen::VectorXd g(3);
+  g << 0.0, 0.0, 0.1;
+  Eigen::VectorXd c(3);
+  c << 1.0, 0.0, 0.0;
+
+  // Reference solution from the exponential of the dense augmented matrix
+  double h{ 3600.0 };
+  Eigen::MatrixXd augmented = Eigen::MatrixXd::Zero(4, 4);
+  augmented.topLeftCorner(3, 3) = a.cwiseInverse().asDiagonal() * (Eigen::MatrixXd(matrix) - Eigen::MatrixXd(r.asDiagonal()));
+  augmented.block(0, 3, 3, 1) = g.cwiseQuotient(a);
+  Eigen::VectorXd w(4);
+  w << c, 1.0;
+  Eigen::VectorXd reference = (h * augmented).exp() * w;
+
+  airflownetwork::transport::ExponentialStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd> stepper(matrix);
+  REQUIRE(stepper.step(h, g, r, a, c));
+  for (int i = 0; i < 3; ++i) {
+    CHECK(c(i) == Approx(reference(i)));
+  }
+
+  // A longer ring with a small subspace needs more than one projection
+  int n{ 40 };
+  Eigen::SparseMatrix<double> ring(n, n);
+  for (int i = 0; i < n; ++i) {
+    ring.insert(i, i) = -1.0;
+    ring.insert((i + 1) % n, i) = 1.0;
+  }
+  ring.makeCompressed();
+  Eigen::VectorXd r2 = Eigen::VectorXd::Constant(n, 1.0e-3);
+  Eigen::VectorXd a2 = Eigen::VectorXd::LinSpaced(n, 1.0, 20.0);
+  Eigen::VectorXd g2 = Eigen::VectorXd::Zero(n);
+  g2(n / 2) = 1.0;
+  Eigen::VectorXd c2 = Eigen::VectorXd::Zero(n);
+  c2(0) = 1.0;
+  augmented = Eigen::MatrixXd::Zero(n + 1, n + 1);
+  augmented.topLeftCorner(n, n) = a2.cwiseInverse().asDiagonal() * (Eigen::MatrixXd(ring) - Eigen::MatrixXd(r2.asDiagonal()));
+  augmented.block(0, n, n, 1) = g2.cwiseQuotient(a2);
+  w.resize(n + 1);
+  w << c2, 1.0;
+  h = 600.0;
+  reference = (h * augmented).exp() * w;
+
+  airflownetwork::transport::ExponentialStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd> small(ring, 10);
+  REQUIRE(small.step(h, g2, r2, a2, c2));
+  CHECK(small.substeps() > 1);
+  for (int i = 0; i < n; ++i) {
+    CHECK(c2(i) == Approx(reference(i)).margin(1.0e-8));
+  }
+
+  // A new base is only copied in if the version changes
+  Eigen::SparseMatrix<double> doubled = 2.0 * ring;
+  Eigen::VectorXd c3 = w.head(n);
+  Eigen::VectorXd c4 = c3;
+  small.set_base(doubled, 0, 0);
+  REQUIRE(small.step(h, g2, r2, a2, c3));
+  for (int i = 0; i < n; ++i) {
+    CHECK(c3(i) == Approx(c2(i)));
+  }
+  small.set_base(doubled, 0, 1);
+  CHECK(small.filter_version() == 1);
+  REQUIRE(small.step(h, g2, r2, a2, c4));
+  CHECK(c4(0) != Approx(c2(0)));
+
+  // A zero capacity breaks the projection down, which fails without touching the concentrations
+  a2(3) = 0.0;
+  c3 = c4;
+  CHECK_FALSE(small.step(h, g2, r2, a2, c3));
+  CHECK(c3 == c4);
+}
+
+TEST_CASE("Test exponential transport on a stiff system, Eigen", "[eigen_transport]")
+{
+  // A small zone with a large exchange flow to a big zone that has a little removal, the explicit time
+  // scale of the small zone is a hundredth of a second
+  Eigen::SparseMatrix<double> matrix(2, 2);
+  matrix.insert(0, 0) = -1.0;
+  matrix.insert(1, 0) = 1.0;
+  matrix.insert(0, 1) = 1.0;
+  matrix.insert(1, 1) = -1.0;
+  matrix.makeCompressed();
+  Eigen::VectorXd r(2);
+  r << 0.0, 1.0e-3;
+  Eigen::VectorXd a(2);
+  a << 0.01, 100.0;
+  Eigen::VectorXd g(2);
+  g << 1.0e-3, 0.0;
+  Eigen::VectorXd c(2);
+  c << 1.0, 0.0;
+
+  airflownetwork::transport::SubcycledStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd, Eigen::SparseLU<Eigen::SparseMatrix<double>>>
+    subcycled(matrix);
+  CHECK(subcycled.stable_step(r, a) == Approx(0.01));
+
+  double h{ 3600.0 };
+  Eigen::MatrixXd augmented = Eigen::MatrixXd::Zero(3, 3);
+  augmented.topLeftCorner(2, 2) = a.cwiseInverse().asDiagonal() * (Eigen::MatrixXd(matrix) - Eigen::MatrixXd(r.asDiagonal()));
+  augmented.block(0, 2, 2, 1) = g.cwiseQuotient(a);
+  Eigen::VectorXd w(3);
+  w << c, 1.0;
+  Eigen::VectorXd reference = (h * augmented).exp() * w;
+
+  // An hour goes in a handful of projections rather than hundreds of thousands of explicit steps
+  airflownetwork::transport::ExponentialStepper<Eigen::SparseMatrix<double>, Eigen::VectorXd> stepper(matrix);
+  REQUIRE(stepper.step(h, g, r, a, c));
+  CHECK(stepper.substeps() <= 4);
+  CHECK(c(0) == Approx(reference(0)));
+  CHECK(c(1) == Approx(reference(1)));
+  // The small zone is quasi-steady, its source is carried off by the exchange flow
+  CHECK(c(0) - c(1) == Approx(1.0e-3).epsilon(1.0e-3));
+}
+
+TEST_CASE("Test the steady state solution, Eigen", "[eigen_transport]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node2(names.intern("Node2"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link0"), node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link1"), node1, node2, powerlaw);
+  for (auto& link : links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+    link.flow = 2.0;
+  }
+  links[0].filters[0].emplace_back(0.5);
+  node0.index = 0;
+  node1.index = 1;
+  node2.index = 2;
+
+  // Node 2 is ambient with a large removal rate standing in for a fixed concentration of zero
+  Eigen::SparseMatrix<double> matrix;
+  airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>> pattern(3, links, matrix);
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+  Eigen::VectorXd g(3);
+  g << 1.0, 0.5, 0.0;
+  Eigen::VectorXd r(3);
+  r << 0.0, 0.0, 1.0;
+  Eigen::VectorXd c(3);
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+  std::vector<size_t> ill_posed;
+  REQUIRE(airflownetwork::transport::steady_state(solver, matrix, g, r, c, ill_posed));
+  CHECK(ill_posed.empty());
+  // Zone 0: 2 C0 = 1, zone 1: 2 C1 = 0.5 * 2 C0 + 0.5, zone 2: C2 = 2 C1
+  CHECK(c(0) == Approx(0.5));
+  CHECK(c(1) == Approx(0.5));
+  CHECK(c(2) == Approx(1.0));
+
+  // Without any removal at the end of the line there is no steady state, node 0 loses material through the
+  // filter but node 1 only passes it along to node 2
+  airflownetwork::transport::matrix(0, matrix, links, pattern);
+  r << 0.0, 0.0, 0.0;
+  CHECK_FALSE(airflownetwork::transport::steady_state(solver, matrix, g, r, c, ill_posed));
+  CHECK(ill_posed == std::vector<size_t>{ 1, 2 });
+}
+
+TEST_CASE("Test the steady state solution with recirculation, Eigen", "[eigen_transport]")
+{
+  // A closed loop 0 -> 1 -> 2 -> 0 with a branch 2 -> 3 -> 0, every diagonal is negative but nothing leaves
+  auto loop = [](double f01, double f20, double f23) {
+    Eigen::SparseMatrix<double> matrix(4, 4);
+    matrix.insert(0, 0) = -f01;
+    matrix.insert(1, 0) = f01;
+    matrix.insert(1, 1) = -f01;
+    matrix.insert(2, 1) = f01;
+    matrix.insert(0, 2) = f20;
+    matrix.insert(2, 2) = -(f20 + f23);
+    matrix.insert(3, 2) = f23;
+    matrix.insert(0, 3) = f23;
+    matrix.insert(3, 3) = -f23;
+    matrix.makeCompressed();
+    return matrix;
+  };
+  Eigen::VectorXd g(4);
+  g << 1.0, 0.0, 0.0, 0.0;
+  Eigen::VectorXd r = Eigen::VectorXd::Zero(4);
+  Eigen::VectorXd c(4);
+  Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+  std::vector<size_t> ill_posed;
+
+  // Flows that balance exactly and flows that only balance to within roundoff
+  for (auto f : { std::array<double, 3>{ 2.0, 1.0, 1.0 }, std::array<double, 3>{ 0.3, 0.1, 0.2 } }) {
+    auto matrix = loop(f[0], f[1], f[2]);
+    CHECK_FALSE(airflownetwork::transport::steady_state(solver, matrix, g, r, c, ill_posed));
+    CHECK(ill_posed == std::vector<size_t>{ 0, 1, 2, 3 });
+  }
+
+  // Removal anywhere in the loop fixes it, and then all of the generation is removed there
+  r(3) = 0.1;
+  auto matrix = loop(0.3, 0.1, 0.2);
+  REQUIRE(airflownetwork::transport::steady_state(solver, matrix, g, r, c, ill_posed));
+  CHECK(ill_posed.empty());
+  CHECK(c(3) == Approx(10.0));
+
+  // Removal that is tiny compared to the rest of the system is caught by the pivot check
+  Eigen::SparseMatrix<double> isolated(2, 2);
+  isolated.insert(0, 0) = 0.0;
+  isolated.insert(1, 1) = 0.0;
+  isolated.makeCompressed();
+  r.resize(2);
+  r << 1.0, 1.0e-14;
+  g.resize(2);
+  g << 1.0, 1.0;
+  CHECK_FALSE(airflownetwork::transport::steady_state(solver, isolated, g, r, c, ill_posed));
+  CHECK(ill_posed.empty());
+  CHECK(airflownetwork::transport::smallest_pivot(solver) == Approx(1.0e-14));
+}
+
+TEST_CASE("Test cached filter pass-through factors, Eigen", "[eigen_transport]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node2(names.intern("Node2"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link0"), node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link1"), node1, node2, powerlaw);
+  links.emplace_back(names.intern("Link2"), node0, node2, powerlaw);
+  for (auto& link : links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(2);
+  }
+  links[0].filters[0].emplace_back(0.5);
+  links[0].filters[0].emplace_back(0.5);
+  links[1].filters[1].emplace_back(1.0);
+  links[0].flow = 1.0;
+  links[1].flow = -2.0;
+  links[2].flow = 0.5;
+  node0.index = 0;
+  node1.index = 1;
+  node2.index = 2;
+
+  airflownetwork::transport::PassThrough<size_t> pass(links, 2);
+  CHECK(pass[0][0] == 0.25);
+  CHECK(pass[0][1] == 1.0);
+  CHECK(pass[1][0] == 1.0);
+  CHECK(pass[1][1] < 0.0);
+  CHECK(pass.blocked[0].empty());
+  CHECK(pass.blocked[1] == std::vector<size_t>{ 1 });
+  CHECK(pass.memory_usage() >= 6 * sizeof(double) + 2 * sizeof(std::vector<size_t>) + sizeof(size_t));
+
+  Eigen::SparseMatrix<double> matrix;
+  airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>> pattern(3, links, matrix);
+  CHECK(pattern.memory_usage() >= 3 * sizeof(int) + 3 * sizeof(airflownetwork::transport::Pattern<Eigen::SparseMatrix<double>>::Offsets));
+  Eigen::SparseMatrix<double> reference = matrix;
+  for (size_t key = 0; key < 2; ++key) {
+    airflownetwork::transport::matrix(key, matrix, links, pattern, pass);
+    airflownetwork::transport::matrix(key, reference, links, pattern);
+    for (int i = 0; i < matrix.nonZeros(); ++i) {
+      CHECK(matrix.valuePtr()[i] == reference.valuePtr()[i]);
+    }
+  }
+
+  // Turn off the blocking filter
+  auto version = pass.version;
+  links[1].filters[1][0].control = 0.0;
+  pass.update(1, links[1]);
+  CHECK(pass.version > version);
+  CHECK(pass[1][1] == 1.0);
+  CHECK(pass.blocked[1].empty());
+  version = pass.version;
+  pass.update(0, links[0]);
+  CHECK(pass.version == version);
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "catch.hpp"
+#include "output.hpp"
+#include <sstream>
+
+TEST_CASE("Test name pattern matching", "[output]")
+{
+  CHECK(airflownetwork::output::match("*", "Zone1"));
+  CHECK(airflownetwork::output::match("Zone1", "Zone1"));
+  CHECK_FALSE(airflownetwork::output::match("Zone1", "Zone10"));
+  CHECK(airflownetwork::output::match("Zone?", "Zone1"));
+  CHECK_FALSE(airflownetwork::output::match("Zone?", "Zone10"));
+  CHECK(airflownetwork::output::match("*one*", "Zone10"));
+  CHECK(airflownetwork::output::match("Z*1*", "Zone1-Zone2"));
+  CHECK_FALSE(airflownetwork::output::match("Z*3", "Zone1-Zone2"));
+  CHECK(airflownetwork::output::match(std::vector<std::string>{ "Duct*", "Zone?" }, "Zone2"));
+  CHECK_FALSE(airflownetwork::output::match(std::vector<std::string>{ "Duct*", "Zone?" }, "Attic"));
+}
+
+TEST_CASE("Test timestep output", "[output]")
+{
+  auto stream = std::make_unique<std::ostringstream>();
+  auto text = stream.get();
+  double value{ 1.0 };
+  airflownetwork::output::Channel channel(std::move(stream));
+  channel.add("value", &value);
+  channel.write_header();
+  channel.record(0.0);
+  value = 2.0;
+  channel.record(60.0);
+  channel.finish();
+  CHECK(text->str() == "Time(s),value\n0,1\n60,2\n");
+}
+
+TEST_CASE("Test hourly aggregation", "[output]")
+{
+  auto stream = std::make_unique<std::ostringstream>();
+  auto text = stream.get();
+  double value{ 0.0 };
+  airflownetwork::output::Channel channel(std::move(stream), airflownetwork::output::hourly, airflownetwork::output::Statistic::All);
+  channel.add("value", &value);
+  channel.write_header();
+
+  // Fifteen minute timesteps, the value at each time is held over the preceding timestep
+  for (int i = 0; i <= 8; ++i) {
+    value = i;
+    channel.record(900.0 * i);
+  }
+  channel.finish();
+
+  std::istringstream lines(text->str());
+  std::string line;
+  std::getline(lines, line);
+  CHECK(line == "Time(s),value:Minimum,value:Maximum,value:Mean,value:Integral");
+  std::getline(lines, line);
+  CHECK(line == "3600,0,4,2.5,9000");
+  std::getline(lines, line);
+  CHECK(line == "7200,5,8,6.5,23400");
+  CHECK_FALSE(std::getline(lines, line));
+}
+
+TEST_CASE("Test aggregation across reporting boundaries", "[output]")
+{
+  airflownetwork::output::Accumulator acc;
+  acc.add(2.0, 0.0);
+  CHECK(acc.mean() == 2.0);
+  acc.add(4.0, 10.0);
+  CHECK(acc.minimum == 2.0);
+  CHECK(acc.maximum == 4.0);
+  CHECK(acc.mean() == 4.0);
+
+  auto stream = std::make_unique<std::ostringstream>();
+  auto text = stream.get();
+  double value{ 1.0 };
+  airflownetwork::output::Channel channel(std::move(stream), 10.0, airflownetwork::output::Statistic::Integral);
+  channel.add("value", &value);
+  channel.record(0.0);
+  // One long step that covers two and a half intervals
+  value = 2.0;
+  channel.record(25.0);
+  channel.finish();
+  CHECK(text->str() == "10,20\n20,20\n25,10\n");
+}
@@ -0,0 +1,246 @@
+// Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "model.hpp"
+#include "eigen_transport.hpp"
+#include "stepper.hpp"
+#include "benchmark.hpp"
+#include "generator.hpp"
+#include "Eigen/Sparse"
+
+// Fixed-size workloads that are timed against a stored baseline, a workload that slows down by more
+// than its tolerance fails the run. The baseline is specific to a machine and build, so it is not kept
+// in the source tree. Record one with --update (e.g. on the base revision) before comparing, a run
+// without a baseline fails. The default location is in the build directory, set the CMake variable
+// AIRFLOWNETWORK_PERF_BASELINE or pass --baseline to use a file kept elsewhere, e.g. one committed
+// to a fork for its CI machines.
+
+#ifndef AIRFLOWNETWORK_INPUT_DIR
+#define AIRFLOWNETWORK_INPUT_DIR "input"
+#endif
+
+#ifndef AIRFLOWNETWORK_PERF_BASELINE
+#define AIRFLOWNETWORK_PERF_BASELINE "perf_baseline.csv"
+#endif
+
+typedef airflownetwork::properties::AIRNET Properties;
+typedef airflownetwork::Model<airflownetwork::Index, Properties> Model;
+typedef Eigen::SparseMatrix<double> Matrix;
+typedef Eigen::VectorXd Vector;
+
+static void reset_pressures(Model& model)
+{
+  for (auto& node : model.simulated_nodes) {
+    node.pressure = Properties::pressure_0;
+  }
+}
+
+static bool load(Model& model, const std::string& xml)
+{
+  pugi::xml_document doc;
+  if (!doc.load_string(xml.c_str()) || !model.load(doc.child("AirflowNetwork"))) {
+    for (auto& mesg : model.errors) {
+      std::cerr << mesg << std::endl;
+    }
+    return false;
+  }
+  model.verbose = false;
+  return true;
+}
+
+static bool generated_workloads(airflownetwork::benchmark::Suite& suite)
+{
+  airflownetwork::generator::Building building;
+  building.stories = 20;
+  building.zones_per_story = 20;
+  building.stairwells = 2;
+  building.shafts = 2;
+  building.duct_depth = 3;
+  building.duct_branching = 4;
+  std::ostringstream stream;
+  airflownetwork::generator::generate(building).write_xml(stream);
+  std::string xml{ stream.str() };
+
+  Model model("generated");
+  if (!load(model, xml)) {
+    return false;
+  }
+  suite.run("generated/load", 1, [&] {
+    Model loaded("load");
+    load(loaded, xml);
+  });
+  model.calculate_pressure_differences();
+  suite.run("generated/filjac", model.links.size(), [&] { model.filjac(); });
+  suite.run("generated/steady_solve", 1, [&] { reset_pressures(model); }, [&] { model.steady_solve(); });
+
+  // Transport of one contaminant released into the first zone
+  for (auto& link : model.links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  }
+  Eigen::Index n{ static_cast<Eigen::Index>(model.node_count()) };
+  Matrix base;
+  airflownetwork::transport::Pattern<Matrix> pattern(static_cast<Matrix::StorageIndex>(n), model.links, base);
+  suite.run("generated/transport_matrix", model.links.size(), [&] {
+    airflownetwork::transport::matrix(0, base, model.links, pattern);
+  });
+  Vector G = Vector::Zero(n);
+  G[0] = 1.0e-6;
+  Vector R = Vector::Constant(n, 1.0e-5);
+  Vector A = Vector::Constant(n, 100.0);
+  Vector C = Vector::Zero(n);
+  Vector G1 = G;
+  airflownetwork::transport::Stepper<Matrix, Vector, Eigen::SparseLU<Matrix>> stepper(base);
+  suite.run("generated/implicit_euler_step", 1, [&] { G1 = G; }, [&] { stepper.implicit_euler(60.0, G1, R, A, C); });
+  double h{ 60.0 };
+  suite.run("generated/implicit_euler_refactor", 1, [&] {
+    G1 = G;
+    h = h == 60.0 ? 30.0 : 60.0;
+  }, [&] { stepper.implicit_euler(h, G1, R, A, C); });
+  return true;
+}
+
+static bool file_workloads(airflownetwork::benchmark::Suite& suite, const std::string& directory)
+{
+  std::ifstream file(directory + "/law-office.xml");
+  if (!file) {
+    std::cerr << "Failed to open \"" << directory << "/law-office.xml\"" << std::endl;
+    return false;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string xml{ contents.str() };
+  Model model("law-office");
+  if (!load(model, xml)) {
+    return false;
+  }
+  suite.run("law_office/load", 1, [&] {
+    Model loaded("load");
+    load(loaded, xml);
+  });
+  suite.run("law_office/steady_solve", 1, [&] { reset_pressures(model); }, [&] { model.steady_solve(); });
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  size_t warmup{ 2 };
+  size_t repetitions{ 15 };
+  size_t attempts{ 3 };
+  double tolerance{ 0.25 };
+  std::string baseline_file{ AIRFLOWNETWORK_PERF_BASELINE };
+  std::string input{ AIRFLOWNETWORK_INPUT_DIR };
+  std::string filter{ "*" };
+  bool update{ false };
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{ argv[i] };
+    if (arg == "--update") {
+      update = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << "usage: perf_tests [--baseline FILE] [--input DIR] [--tolerance FRACTION] [--repetitions N] [--attempts N] [--filter PATTERN] [--update]"
+        << std::endl;
+      return 1;
+    }
+    std::string value{ argv[++i] };
+    if (arg == "--baseline") {
+      baseline_file = value;
+    } else if (arg == "--input") {
+      input = value;
+    } else if (arg == "--tolerance") {
+      tolerance = std::stod(value);
+    } else if (arg == "--repetitions") {
+      repetitions = std::stoul(value);
+    } else if (arg == "--attempts") {
+      attempts = std::max<size_t>(1, std::stoul(value));
+    } else if (arg == "--filter") {
+      filter = value;
+    } else {
+      std::cerr << "Unrecognized argument \"" << arg << '\"' << std::endl;
+      return 1;
+    }
+  }
+
+  airflownetwork::benchmark::Baseline baseline;
+  std::ifstream stream(baseline_file);
+  if (stream && !baseline.read(stream)) {
+    for (auto& mesg : baseline.errors) {
+      std::cerr << mesg << std::endl;
+    }
+    return 1;
+  }
+  stream.close();
+
+  if (!update && baseline.entries.empty()) {
+    std::cerr << "No baseline in \"" << baseline_file << "\", record one with --update or point --baseline at one"
+      << std::endl;
+    return 1;
+  }
+
+  // Timings on a busy machine only ever get slower, so a failing comparison is retried and the
+  // fastest result for each workload over all the attempts is kept
+  std::vector<airflownetwork::benchmark::Result> best;
+  for (size_t attempt = 0; attempt < attempts; ++attempt) {
+    airflownetwork::benchmark::Suite suite(warmup, repetitions, filter);
+    if (!generated_workloads(suite) || !file_workloads(suite, input)) {
+      return 1;
+    }
+    if (best.empty()) {
+      best = suite.results;
+    } else {
+      for (size_t i = 0; i < best.size(); ++i) {
+        if (suite.results[i].fastest() < best[i].fastest()) {
+          best[i] = suite.results[i];
+        }
+      }
+    }
+    if (!update) {
+      std::ostringstream report;
+      if (baseline.compare(best, tolerance, report)) {
+        std::cout << report.str();
+        return 0;
+      }
+      if (attempt + 1 == attempts) {
+        std::cout << report.str() << "Performance regression" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  baseline.update(best);
+  std::ofstream file(baseline_file);
+  baseline.write(file);
+  for (auto& result : best) {
+    std::cout << result.name << ": " << result.fastest() << " ns/op" << std::endl;
+  }
+  std::cout << "Updated baseline \"" << baseline_file << '\"' << std::endl;
+  return 0;
+}
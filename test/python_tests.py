@@ -0,0 +1,110 @@
+# Copyright (c) 2019, Alliance for Sustainable Energy, LLC
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+"""Tests of the Python interface, run with the library built (or AIRFLOWNETWORK_LIBRARY set)"""
+import os
+import sys
+import unittest
+
+here = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(here, '..', 'scripts'))
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+law_office = os.environ.get('AIRFLOWNETWORK_INPUT_DIR', os.path.join(here, '..', 'input'))
+law_office = os.path.join(law_office, 'law-office.xml')
+
+@unittest.skipIf(np is None, 'numpy is not installed')
+class TestPython(unittest.TestCase):
+    def test_views(self):
+        import airflownetwork as afn
+        with afn.Model.from_xml_file(law_office) as model:
+            lib = afn.library()
+            pressures = model.pressures
+            flows = model.flows
+            self.assertFalse(pressures.flags.writeable)
+            model.solve()
+            # The views were taken before the solve and still see the results
+            expected_pressures = np.empty(model.node_count)
+            expected_flows = np.empty(model.link_count)
+            self.assertEqual(lib.afn_get_pressures(model._handle, expected_pressures.ctypes.data_as(afn._double_p),
+                                                   model.node_count), afn.OK)
+            self.assertEqual(lib.afn_get_flows(model._handle, expected_flows.ctypes.data_as(afn._double_p),
+                                               model.link_count), afn.OK)
+            np.testing.assert_array_equal(pressures[model.node_index], expected_pressures)
+            np.testing.assert_array_equal(flows, expected_flows)
+            self.assertTrue(np.any(flows != 0.0))
+
+            model.set_link_control(0, 0.0)
+            model.solve()
+            self.assertEqual(flows[0], 0.0)
+            with self.assertRaises(afn.Error):
+                model.set_link_control(model.link_count, 0.0)
+
+    def test_arrays(self):
+        import airflownetwork as afn
+        # A chain of three cracks between two fixed pressures
+        arrays = dict(node_types=[afn.FIXED, afn.SIMULATED, afn.SIMULATED, afn.FIXED], coefficients=[1.0e-5],
+                      node0=[0, 1, 2], node1=[1, 2, 3], elements=[0, 0, 0],
+                      pressures=[101525.0, 101325.0, 101325.0, 101325.0])
+        with afn.Model.from_arrays(exponents=None, **arrays) as default, \
+                afn.Model.from_arrays(exponents=[0.65], **arrays) as given:
+            default.set_tolerance(1.0e-12, 50)
+            given.set_tolerance(1.0e-12, 50)
+            default.solve()
+            given.solve()
+            np.testing.assert_allclose(np.abs(default.flows), np.abs(default.flows[0]))
+            self.assertGreater(abs(default.flows[0]), 0.0)
+            np.testing.assert_array_equal(default.flows, given.flows)
+
+            # Only the controls change from case to case
+            controls = np.ones((2, default.link_count))
+            controls[1, 1] = 0.0
+            pressures, flows, status = default.solve_batch([], None, controls)
+            self.assertEqual(flows.shape, (2, default.link_count))
+            np.testing.assert_array_equal(status, [afn.OK, afn.OK])
+            np.testing.assert_allclose(flows[0], given.flows)
+            self.assertEqual(flows[1, 1], 0.0)
+            with self.assertRaises(afn.Error):
+                default.solve_batch([], None)
+
+        with self.assertRaises(afn.Error):
+            afn.Model.from_arrays(exponents=[0.65, 0.5], **arrays)
+        arrays['pressures'] = [101525.0]
+        with self.assertRaises(afn.Error):
+            afn.Model.from_arrays(exponents=None, **arrays)
+
+    def test_failed_create(self):
+        import airflownetwork as afn
+        with self.assertRaises(afn.Error):
+            afn.Model.from_xml_string('<Nothing/>')
+
+if __name__ == '__main__':
+    unittest.main()
@@ -31,7 +31,9 @@
 #include "properties.hpp"
 #include "powerlaw.hpp"
 #include "transport.hpp"
+#include "profile.hpp"
 #include "Eigen/Sparse"
+#include "Eigen/Dense"
 
 struct LocalMatrix
 {
@@ -54,12 +56,13 @@ struct LocalMatrix
 TEST_CASE("Test a very simple network", "[transport_matrix]")
 {
 
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
-  //airflownetwork::Link<size_t, airflownetwork::properties::Fixed> link("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
+  //airflownetwork::Link<size_t, airflownetwork::properties::Fixed> link(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -128,11 +131,12 @@ TEST_CASE("Test a very simple network", "[transport_matrix]")
 
 TEST_CASE("Test a very simple network with Eigen, explicit", "[transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -176,11 +180,12 @@ TEST_CASE("Test a very simple network with Eigen, explicit", "[transport]")
 
 TEST_CASE("Test a very simple network with Eigen, opposite direction explicit", "[transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -224,11 +229,12 @@ TEST_CASE("Test a very simple network with Eigen, opposite direction explicit",
 
 TEST_CASE("Test a very simple network with zero with Eigen, explicit", "[transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -272,11 +278,12 @@ TEST_CASE("Test a very simple network with zero with Eigen, explicit", "[transpo
 
 TEST_CASE("Test a very simple network with Eigen, implicit", "[transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -324,11 +331,12 @@ TEST_CASE("Test a very simple network with Eigen, implicit", "[transport]")
 
 TEST_CASE("Test a very simple network with Eigen, implicit with complications", "[transport]")
 {
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0("Node0");
-  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1("Node1");
-  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw("powerlaw", 0.001, 0.001);
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
   std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
-  links.emplace_back("Link", node0, node1, powerlaw);
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
 
   airflownetwork::Filter filter(0.5);
 
@@ -377,3 +385,100 @@ TEST_CASE("Test a very simple network with Eigen, implicit with complications",
   //CHECK(0.5 * (c0(0) - c(0)) == Approx(c(1) - c0(1)));
 }
 
+
+TEST_CASE("Test a two-way flow link", "[transport_matrix]")
+{
+  airflownetwork::NameTable names;
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node0(names.intern("Node0"));
+  airflownetwork::Node<size_t, airflownetwork::properties::Fixed> node1(names.intern("Node1"));
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link"), node0, node1, powerlaw);
+
+  links[0].filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  links[0].filters[0].emplace_back(0.5);
+  links[0].nf = 2;
+  links[0].flow0 = 1.0;
+  links[0].flow1 = 0.5;
+
+  node0.index = 0;
+  node1.index = 3;
+  links[0].index0 = 1;
+  links[0].index1 = 2;
+
+  LocalMatrix matrix(4);
+  airflownetwork::transport::matrix(0, matrix, links);
+
+  std::vector<double> correct_matrix{ {-1.0, 0.25, 0.5, -0.5} };
+  for (size_t i = 0; i < 4; ++i) {
+    INFO("The index is " << i);
+    CHECK(matrix(i) == correct_matrix[i]);
+  }
+}
+
+TEST_CASE("Test a profile LU solve", "[transport]")
+{
+  airflownetwork::NameTable names;
+  std::vector<airflownetwork::Node<size_t, airflownetwork::properties::Fixed>> nodes;
+  for (size_t i = 0; i < 5; ++i) {
+    nodes.emplace_back(names.intern("Node" + std::to_string(i)));
+    nodes.back().index = i;
+  }
+  airflownetwork::PowerLaw<airflownetwork::properties::Fixed> powerlaw(names.intern("powerlaw"), 0.001, 0.001);
+  std::vector<airflownetwork::Link<size_t, airflownetwork::properties::Fixed>> links;
+  links.emplace_back(names.intern("Link0"), nodes[0], nodes[1], powerlaw);
+  links.emplace_back(names.intern("Link1"), nodes[1], nodes[2], powerlaw);
+  links.emplace_back(names.intern("Link2"), nodes[0], nodes[3], powerlaw);
+  links.emplace_back(names.intern("Link3"), nodes[3], nodes[4], powerlaw);
+  links.emplace_back(names.intern("Link4"), nodes[2], nodes[4], powerlaw);
+  for (auto& link : links) {
+    link.filters = std::vector<std::vector<airflownetwork::Filter>>(1);
+  }
+  links[0].flow = 1.0;
+  links[1].flow = -0.5;
+  links[2].flow = 2.0;
+  links[2].filters[0].emplace_back(0.25);
+  links[3].nf = 2;
+  links[3].flow0 = 0.75;
+  links[3].flow1 = 0.25;
+  links[4].flow = 1.5;
+
+  auto heights = airflownetwork::ProfileMatrix<size_t>::heights(5, links);
+  CHECK(heights == std::vector<size_t>{ 0, 1, 1, 3, 2 });
+  airflownetwork::ProfileMatrix<size_t> matrix(heights);
+  CHECK(matrix.size() == 5 + 2 * 7);
+  CHECK_FALSE(matrix.index(0, 2));
+  CHECK(matrix.index(3, 3).value() == 3);
+  airflownetwork::transport::matrix(0, matrix, links);
+
+  // Compare with a dense version of the same matrix
+  Eigen::MatrixXd dense = Eigen::MatrixXd::Zero(5, 5);
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      auto k = matrix.index(i, j);
+      if (k) {
+        dense(i, j) = matrix(k.value());
+      }
+    }
+  }
+  CHECK(dense(0, 0) == -3.0);
+  CHECK(dense(3, 0) == 1.5);
+  CHECK(dense(3, 4) == 0.25);
+
+  // Implicit Euler system
+  double h{ 0.5 };
+  matrix.scale(-h);
+  dense *= -h;
+  for (size_t i = 0; i < 5; ++i) {
+    matrix.diagonal(i) += 1.0 + i;
+    dense(i, i) += 1.0 + i;
+  }
+  Eigen::VectorXd b(5);
+  b << 1.0, 0.0, 0.5, 0.0, 0.25;
+  Eigen::VectorXd expected = dense.lu().solve(b);
+  REQUIRE(matrix.lu());
+  matrix.solve(b);
+  for (int i = 0; i < 5; ++i) {
+    CHECK(b(i) == Approx(expected(i)));
+  }
+}